@@ -1,33 +1,24 @@
 #include "3D_tools.hpp"
 #include "draw_scene.hpp"
+#include "renderer.hpp"
+#include "tessellation.hpp"
+#include "math3d.hpp"
 
 /* Camera parameters and functions */
 float theta = 0.;       // Angle between x axis and viewpoint
 float phy = 90.;        // Angle between z axis and viewpoint
 float dist_zoom = 3.0f; // Distance between origin and viewpoint
 
-void setCamera()
+void setCamera(Renderer &renderer)
 {
-    glMatrixMode(GL_MODELVIEW);
-    glLoadIdentity();
-    glTranslatef(0., 0., -10.);
-    glRotatef(-90, 1., 0., 0.);
+    renderer.loadIdentity();
+    renderer.translate(0., 0., -10.);
+    renderer.rotate(-90, 1., 0., 0.);
 }
 
-void setPerspective(float fovy, float a_ratio, float z_near, float z_far)
+void setPerspective(Renderer &renderer, float fovy, float a_ratio, float z_near, float z_far)
 {
-    float mat[16] = {0.0f};
-
-    double f = 1.0 / tan(fovy * M_PI / 360.0); // 1/tan(fovy/2)
-    mat[0] = f / a_ratio;
-    mat[5] = f;
-    mat[10] = -(z_far + z_near) / (z_far - z_near);
-    mat[11] = -1.0f;
-    mat[14] = -2.0f * z_far * z_near / (z_far - z_near);
-    mat[15] = 0.0f;
-
-    glMatrixMode(GL_PROJECTION);
-    glLoadMatrixf(mat);
+    renderer.setProjection(Mat4::perspective(fovy, a_ratio, z_near, z_far).m);
 }
 
 /* Convert degree to radians */
@@ -56,51 +47,66 @@ void drawEmptySquare()
     glEnd();
 }
 
-void drawCircle()
+using tessellation::CircleTable;
+using tessellation::SphereTable;
+
+static const float *const CIRCLE_TABLES[NB_LOD_LEVELS] = {
+    CircleTable<LOD_SEGMENTS[0]>::vertices,
+    CircleTable<LOD_SEGMENTS[1]>::vertices,
+    CircleTable<LOD_SEGMENTS[2]>::vertices,
+    CircleTable<LOD_SEGMENTS[3]>::vertices};
+
+static const float *const SPHERE_TABLES[NB_LOD_LEVELS] = {
+    SphereTable<LOD_SEGMENTS[0]>::vertices,
+    SphereTable<LOD_SEGMENTS[1]>::vertices,
+    SphereTable<LOD_SEGMENTS[2]>::vertices,
+    SphereTable<LOD_SEGMENTS[3]>::vertices};
+
+const float *circleVertices(int lod)
+{
+    return CIRCLE_TABLES[lod];
+}
+
+const float *sphereVertices(int lod)
+{
+    return SPHERE_TABLES[lod];
+}
+
+void drawCircle(int lod)
 {
+    const float *circle = circleVertices(lod);
     glBegin(GL_TRIANGLE_FAN);
     glVertex3f(0.0, 0.0, 0.0);
-    float step_rad = 2 * M_PI / (float)NB_SEG_CIRCLE;
-    for (int i = 0; i <= NB_SEG_CIRCLE; i++)
+    for (int i = 0; i <= LOD_SEGMENTS[lod]; i++)
     {
-        glVertex3f(cos(i * step_rad), sin(i * step_rad), 0.0f);
+        glVertex3f(circle[2 * i], circle[2 * i + 1], 0.0f);
     }
     glEnd();
 }
 
-void drawCone()
+void drawCone(int lod)
 {
+    const float *circle = circleVertices(lod);
     glBegin(GL_TRIANGLE_FAN);
     glVertex3f(0.0, 0.0, 1.0);
-    float step_rad = 2 * M_PI / (float)NB_SEG_CIRCLE;
-    for (int i = 0; i <= NB_SEG_CIRCLE; i++)
+    for (int i = 0; i <= LOD_SEGMENTS[lod]; i++)
     {
-        glVertex3f(cos(i * step_rad), sin(i * step_rad), 0.0f);
+        glVertex3f(circle[2 * i], circle[2 * i + 1], 0.0f);
     }
     glEnd();
 }
 
-void drawSphere()
+void drawSphere(int lod)
 {
-    float angle_theta{0.0};
-    float angle_alpha{0.0};
-    float pas_angle_theta{M_PI / NB_SEG_CIRCLE};
-    float pas_angle_alpha{2 * M_PI / NB_SEG_CIRCLE};
-    for (int band{0}; band < NB_SEG_CIRCLE; band++)
+    const float *sphere = sphereVertices(lod);
+    int stripVertices = 2 * (LOD_SEGMENTS[lod] + 1);
+    for (int band{0}; band < LOD_SEGMENTS[lod]; band++)
     {
-        angle_alpha = 0.0;
         glBegin(GL_TRIANGLE_STRIP);
-        for (int count{0}; count <= NB_SEG_CIRCLE; count++)
+        for (int i = band * stripVertices; i < (band + 1) * stripVertices; i++)
         {
-            glVertex3f(cosf(angle_alpha) * sinf(angle_theta),
-                       sinf(angle_alpha) * sinf(angle_theta),
-                       cosf(angle_theta));
-            glVertex3f(cosf(angle_alpha) * sinf(angle_theta + pas_angle_theta),
-                       sinf(angle_alpha) * sinf(angle_theta + pas_angle_theta),
-                       cosf(angle_theta + pas_angle_theta));
-            angle_alpha += pas_angle_alpha;
+            glVertex3fv(&sphere[3 * i]);
         }
         glEnd();
-        angle_theta += pas_angle_theta;
     }
 }
@@ -8,6 +8,14 @@
 
 #define NB_SEG_CIRCLE 64
 
+/* Tessellation levels of the round objects (segments per turn),
+   the last one is the full NB_SEG_CIRCLE quality */
+static constexpr int NB_LOD_LEVELS = 4;
+static constexpr int LOD_SEGMENTS[NB_LOD_LEVELS] = {8, 16, 32, NB_SEG_CIRCLE};
+static const int LOD_HIGHEST = NB_LOD_LEVELS - 1;
+
+class Renderer;
+
 /* Camera parameters and functions */
 static const float Z_NEAR = 0.1f;
 static const float Z_FAR = 100.f;
@@ -15,19 +23,25 @@ extern float theta;     // Angle between x axis and viewpoint
 extern float phy;       // Angle between z axis and viewpoint
 extern float dist_zoom; // Distance between origin and viewpoint
 
-void setCamera();
-void setPerspective(float fovy, float a_ratio, float z_near, float z_far);
+void setCamera(Renderer &renderer);
+void setPerspective(Renderer &renderer, float fovy, float a_ratio, float z_near, float z_far);
 
 /* Draw cannonic objet functions */
 void drawSquare();
 
 void drawEmptySquare();
 
-void drawCircle();
+void drawCircle(int lod = LOD_HIGHEST);
+
+void drawCone(int lod = LOD_HIGHEST);
 
-void drawCone();
+void drawSphere(int lod = LOD_HIGHEST);
 
-void drawSphere();
+/* Unit geometry of each level, compile-time tables (see tessellation.hpp) */
+// Unit circle: LOD_SEGMENTS[lod] + 1 (x, y) points, the first one repeated at the end
+const float *circleVertices(int lod);
+// Unit sphere: LOD_SEGMENTS[lod] bands, each a triangle strip of 2 * (LOD_SEGMENTS[lod] + 1) (x, y, z) points
+const float *sphereVertices(int lod);
 
 /* Small tools */
 float toRad(float deg);
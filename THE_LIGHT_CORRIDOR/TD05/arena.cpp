@@ -0,0 +1,72 @@
+#include "arena.hpp"
+#include <algorithm>
+
+MonotonicArena::MonotonicArena(std::size_t _firstBlockSize)
+    : firstBlockSize{_firstBlockSize}, current{0}, offset{0}, usedInPreviousBlocks{0}
+{
+}
+
+MonotonicArena::~MonotonicArena()
+{
+    for (size_t i = 0; i < blocks.size(); i++)
+    {
+        ::operator delete(blocks[i].data);
+    }
+}
+
+void *MonotonicArena::allocate(std::size_t bytes, std::size_t alignment)
+{
+    while (current < blocks.size())
+    {
+        Block &block = blocks[current];
+        std::size_t start = (offset + alignment - 1) & ~(alignment - 1);
+        if (start + bytes <= block.size)
+        {
+            offset = start + bytes;
+            return block.data + start;
+        }
+        // Kept blocks too small for this request are skipped until the next reset
+        if (current + 1 == blocks.size())
+        {
+            break;
+        }
+        usedInPreviousBlocks += block.size;
+        current++;
+        offset = 0;
+    }
+
+    // New block, at least twice the last one (::operator new aligns for any type)
+    std::size_t size = blocks.empty() ? firstBlockSize : 2 * blocks.back().size;
+    size = std::max(size, bytes);
+    Block block = {static_cast<char *>(::operator new(size)), size};
+    if (!blocks.empty())
+    {
+        usedInPreviousBlocks += blocks[current].size;
+    }
+    blocks.push_back(block);
+    current = blocks.size() - 1;
+    offset = bytes;
+    return block.data;
+}
+
+void MonotonicArena::reset()
+{
+    current = 0;
+    offset = 0;
+    usedInPreviousBlocks = 0;
+}
+
+std::size_t MonotonicArena::used() const
+{
+    return usedInPreviousBlocks + offset;
+}
+
+std::size_t MonotonicArena::capacity() const
+{
+    std::size_t total = 0;
+    for (size_t i = 0; i < blocks.size(); i++)
+    {
+        total += blocks[i].size;
+    }
+    return total;
+}
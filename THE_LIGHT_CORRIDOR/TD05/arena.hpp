@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+/* Monotonic arena for the data of one level (obstacles, and later bonuses
+   and effects): allocations only move a cursor forward and are never freed
+   one by one. reset() gives everything back at once by rewinding the
+   cursor to the first block; the blocks stay owned by the arena, so the
+   next level reuses them without touching the heap. */
+class MonotonicArena
+{
+public:
+    explicit MonotonicArena(std::size_t firstBlockSize = 4096);
+    ~MonotonicArena();
+
+    MonotonicArena(const MonotonicArena &) = delete;
+    MonotonicArena &operator=(const MonotonicArena &) = delete;
+
+    void *allocate(std::size_t bytes, std::size_t alignment);
+
+    // Everything allocated so far must not be used anymore
+    void reset();
+
+    std::size_t used() const;     // bytes handed out since the last reset
+    std::size_t capacity() const; // bytes of all the blocks
+
+private:
+    class Block
+    {
+    public:
+        char *data;
+        std::size_t size;
+    };
+
+    std::vector<Block> blocks;
+    std::size_t firstBlockSize;
+    std::size_t current; // block the cursor is in
+    std::size_t offset;  // cursor inside blocks[current]
+    std::size_t usedInPreviousBlocks;
+};
+
+/* Standard allocator drawing from a MonotonicArena, for the containers of
+   per level data: std::vector<T, ArenaAllocator<T>>. deallocate() does
+   nothing, the memory comes back with MonotonicArena::reset(). A default
+   constructed allocator has no arena and uses the heap. */
+template <class T>
+class ArenaAllocator
+{
+public:
+    typedef T value_type;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+
+    MonotonicArena *arena;
+
+    ArenaAllocator()
+        : arena{NULL}
+    {
+    }
+
+    explicit ArenaAllocator(MonotonicArena *_arena)
+        : arena{_arena}
+    {
+    }
+
+    template <class U>
+    ArenaAllocator(const ArenaAllocator<U> &other)
+        : arena{other.arena}
+    {
+    }
+
+    T *allocate(std::size_t n)
+    {
+        if (!arena)
+        {
+            return static_cast<T *>(::operator new(n * sizeof(T)));
+        }
+        return static_cast<T *>(arena->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T *pointer, std::size_t)
+    {
+        if (!arena)
+        {
+            ::operator delete(pointer);
+        }
+    }
+};
+
+template <class T, class U>
+bool operator==(const ArenaAllocator<T> &a, const ArenaAllocator<U> &b)
+{
+    return a.arena == b.arena;
+}
+
+template <class T, class U>
+bool operator!=(const ArenaAllocator<T> &a, const ArenaAllocator<U> &b)
+{
+    return a.arena != b.arena;
+}
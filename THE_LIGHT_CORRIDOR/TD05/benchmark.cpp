@@ -0,0 +1,327 @@
+#include "glad/glad.h"
+#include "benchmark.hpp"
+#include "3D_tools.hpp"
+#include "draw_scene.hpp"
+#include "framebuffer.hpp"
+#include "scene_cache.hpp"
+#include "governor.hpp"
+#include "profiler.hpp"
+#include "memory_tracker.hpp"
+#include "perf_counters.hpp"
+#include "perf_baseline.hpp"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+
+/* GPU timestamp queries are read a few frames late to avoid stalling the pipeline */
+static const int QUERY_LATENCY = 4;
+
+/* Frame budget of the governor */
+static const double BUDGET_MS = 1000. / 60.;
+
+/* Frames that build the caches of the renderer and the driver (meshes,
+   scene trees, shader compilation), not counted by allocations_after_warmup */
+static const int WARMUP_FRAMES = 60;
+
+/* Scripted path: one step forward every FRAMES_PER_STEP frames */
+static const int FRAMES_PER_STEP = 10;
+
+static double elapsedMs(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Time between the two GL_TIMESTAMP queries of a frame
+static double queryElapsedMs(const GLuint query[2])
+{
+    GLuint64 start = 0, end = 0;
+    glGetQueryObjectui64v(query[0], GL_QUERY_RESULT, &start);
+    glGetQueryObjectui64v(query[1], GL_QUERY_RESULT, &end);
+    return (end - start) / 1e6;
+}
+
+double percentile(std::vector<double> values, double p)
+{
+    if (values.empty())
+    {
+        return 0.;
+    }
+    std::sort(values.begin(), values.end());
+    size_t rank = (size_t)std::ceil(p / 100. * values.size());
+    return values[std::min(values.size() - 1, rank > 0 ? rank - 1 : 0)];
+}
+
+// Scripted player: the racket follows the ball, the ball is thrown at once
+// and the player moves forward at a fixed pace, so the whole corridor is
+// travelled without any input.
+static void scriptedInput(Game &game, int frame)
+{
+    if (game.gameState != ONGOING)
+    {
+        game.loadGame();
+    }
+    Scalar xLimit = (Scalar(CORRIDOR_WIDTH) - game.player.size) / 2;
+    Scalar zLimit = (Scalar(CORRIDOR_HEIGHT) - game.player.size) / 2;
+    game.player.pos.x = std::max(-xLimit, std::min(xLimit, game.ball.pos.x));
+    game.player.pos.z = std::max(-zLimit, std::min(zLimit, game.ball.pos.z));
+    if (!game.ball.isThrown)
+    {
+        game.ball.isThrown = true;
+    }
+    else if (frame % FRAMES_PER_STEP == 0)
+    {
+        game.moveForward(1);
+    }
+}
+
+static void printSummary(const char *name, const std::vector<double> &values)
+{
+    std::cout << std::fixed << std::setprecision(3)
+              << name << " ms: p50 " << percentile(values, 50)
+              << "  p95 " << percentile(values, 95)
+              << "  p99 " << percentile(values, 99) << std::endl;
+}
+
+// Write the metrics and compare them with the baseline, as asked in options
+static int checkMetrics(const BenchmarkOptions &options, const std::vector<Metric> &metrics)
+{
+    if (!options.jsonPath.empty() && !writeMetricsJson(options.jsonPath, metrics))
+    {
+        std::cout << "Cannot write " << options.jsonPath << std::endl;
+        return -1;
+    }
+    if (options.baselinePath.empty())
+    {
+        return 0;
+    }
+    int regressions = compareWithBaseline(options.baselinePath, metrics, options.toleranceScale);
+    if (regressions < 0)
+    {
+        return -1;
+    }
+    if (regressions > 0)
+    {
+        std::cout << regressions << " metric(s) regressed" << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+// Scripted run without drawing: options.frames simulation ticks
+static int runSimulationBenchmark(Game &game, const BenchmarkOptions &options)
+{
+    game.loadGame();
+    AllocationCounters before = allocationCounters();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int tick = 0; tick < options.frames; tick++)
+    {
+        PROFILE_ZONE("simulation");
+        scriptedInput(game, tick);
+        game.step();
+    }
+    double elapsed = elapsedMs(start);
+    AllocationCounters after = allocationCounters();
+
+    std::vector<Metric> metrics;
+    metrics.push_back({"ticks_per_second", options.frames / (elapsed / 1000.)});
+    metrics.push_back({"allocations_per_tick", (after.count - before.count) / (double)options.frames});
+    metrics.push_back({"allocated_bytes_per_tick", (after.bytes - before.bytes) / (double)options.frames});
+    std::cout << std::fixed << std::setprecision(3)
+              << options.frames << " simulation ticks in " << elapsed << " ms: "
+              << metrics[0].value << " ticks/s, " << metrics[1].value << " allocations/tick" << std::endl;
+    return checkMetrics(options, metrics);
+}
+
+int runHeadlessBenchmark(Renderer &renderer, Game &game, const BenchmarkOptions &options)
+{
+    if (options.simulationOnly)
+    {
+        return runSimulationBenchmark(game, options);
+    }
+
+    bool useGL = renderer.usesGL();
+    bool useQueries = useGL && GLAD_GL_VERSION_3_3; // timestamp queries are core since 3.3
+
+    Framebuffer target;
+    GLuint queries[2 * QUERY_LATENCY] = {0};
+    if (useGL)
+    {
+        if (!target.create(options.width, options.height))
+        {
+            return -1;
+        }
+        target.bind();
+    }
+    if (useQueries)
+    {
+        glGenQueries(2 * QUERY_LATENCY, queries);
+    }
+    renderer.setViewport(options.width, options.height);
+    SceneCache *sceneCache = (useGL && options.sceneCache) ? new SceneCache() : NULL;
+    QualityGovernor *governor = options.governor ? new QualityGovernor(BUDGET_MS) : NULL;
+    setPerspective(renderer, 60.0f, options.width / (float)options.height, Z_NEAR, Z_FAR);
+    setCamera(renderer);
+
+    std::string perfError;
+    if (options.perfCounters && !startPerfCounters(&perfError))
+    {
+        std::cout << "Hardware counters unavailable (" << perfError << "), timings only" << std::endl;
+    }
+
+    std::vector<FrameTiming> timings(options.frames);
+    game.loadGame();
+    AllocationCounters allocationsBefore = allocationCounters();
+    AllocationCounters allocationsWarm = allocationsBefore;
+
+    for (int frame = 0; frame < options.frames; frame++)
+    {
+        if (frame == WARMUP_FRAMES)
+        {
+            allocationsWarm = allocationCounters();
+        }
+        std::chrono::steady_clock::time_point frameStart = std::chrono::steady_clock::now();
+        PROFILE_ZONE("frame");
+
+        {
+            PROFILE_ZONE("simulation");
+            PERF_REGION("simulation");
+            scriptedInput(game, frame);
+            game.step();
+        }
+        timings[frame].simulation = elapsedMs(frameStart);
+
+        std::chrono::steady_clock::time_point drawStart = std::chrono::steady_clock::now();
+        GLuint *query = &queries[2 * (frame % QUERY_LATENCY)];
+        timings[frame].gpu = -1.;
+        if (useQueries)
+        {
+            // Result of the query we are about to reuse
+            if (frame >= QUERY_LATENCY)
+            {
+                timings[frame - QUERY_LATENCY].gpu = queryElapsedMs(query);
+            }
+            glQueryCounter(query[0], GL_TIMESTAMP);
+        }
+        if (useGL)
+        {
+            glClearColor(0.2, 0.0, 0.0, 0.0);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        }
+        if (governor)
+        {
+            governor->beginFrame(renderer);
+        }
+        {
+            PROFILE_ZONE("draw");
+            PERF_REGION("draw");
+            MEMORY_TAG(MEMORY_TAG_RENDERING);
+            renderer.beginFrame();
+            if (game.gameState == ONGOING)
+            {
+                if (sceneCache)
+                {
+                    sceneCache->draw(renderer, game);
+                }
+                else
+                {
+                    drawGame(renderer, game);
+                }
+            }
+            renderer.endFrame();
+        }
+        if (governor)
+        {
+            governor->endFrame(renderer);
+        }
+        if (useQueries)
+        {
+            glQueryCounter(query[1], GL_TIMESTAMP);
+        }
+        timings[frame].cpu = elapsedMs(drawStart);
+
+        if (useGL)
+        {
+            PROFILE_ZONE("finish");
+            glFinish();
+        }
+        timings[frame].frame = elapsedMs(frameStart);
+        if (governor)
+        {
+            governor->frameFinished(timings[frame].frame);
+        }
+        memoryFrameFinished();
+    }
+
+    stopPerfCounters();
+    AllocationCounters allocationsAfter = allocationCounters();
+
+    if (useQueries)
+    {
+        for (int frame = std::max(0, options.frames - QUERY_LATENCY); frame < options.frames; frame++)
+        {
+            timings[frame].gpu = queryElapsedMs(&queries[2 * (frame % QUERY_LATENCY)]);
+        }
+        glDeleteQueries(2 * QUERY_LATENCY, queries);
+    }
+    if (useGL)
+    {
+        Framebuffer::bindDefault();
+    }
+    if (sceneCache)
+    {
+        std::cout << "scene cache rebuilt " << sceneCache->rebuilds << " times" << std::endl;
+        delete sceneCache;
+    }
+    if (governor)
+    {
+        std::cout << "governor: " << governor->decisions().size() << " decisions, final level " << governor->level() << std::endl;
+        if (!options.governorLog.empty() && !governor->writeLog(options.governorLog))
+        {
+            std::cout << "Cannot write " << options.governorLog << std::endl;
+        }
+        delete governor;
+    }
+
+    std::ofstream csv(options.csvPath.c_str());
+    if (!csv)
+    {
+        std::cout << "Cannot write " << options.csvPath << std::endl;
+        return -1;
+    }
+    csv << "frame,simulation_ms,cpu_ms,gpu_ms,frame_ms" << std::endl;
+    std::vector<double> simulation, cpu, gpu, total;
+    for (int frame = 0; frame < options.frames; frame++)
+    {
+        const FrameTiming &timing = timings[frame];
+        csv << frame << ',' << timing.simulation << ',' << timing.cpu << ',' << timing.gpu << ',' << timing.frame << '\n';
+        simulation.push_back(timing.simulation);
+        cpu.push_back(timing.cpu);
+        if (timing.gpu >= 0.)
+        {
+            gpu.push_back(timing.gpu);
+        }
+        total.push_back(timing.frame);
+    }
+
+    std::cout << options.frames << " frames, renderer " << renderer.name()
+              << ", " << options.width << "x" << options.height << " -> " << options.csvPath << std::endl;
+    printSummary("simulation", simulation);
+    printSummary("cpu", cpu);
+    if (!gpu.empty())
+    {
+        printSummary("gpu", gpu);
+    }
+    printSummary("frame", total);
+    printPerfReport();
+
+    std::vector<Metric> metrics;
+    metrics.push_back({"frame_ms_p50", percentile(total, 50)});
+    metrics.push_back({"frame_ms_p99", percentile(total, 99)});
+    metrics.push_back({"allocations_per_frame", (allocationsAfter.count - allocationsBefore.count) / (double)options.frames});
+    if (options.frames > WARMUP_FRAMES)
+    {
+        metrics.push_back({"allocations_after_warmup", (allocationsAfter.count - allocationsWarm.count) / (double)(options.frames - WARMUP_FRAMES)});
+    }
+    return checkMetrics(options, metrics);
+}
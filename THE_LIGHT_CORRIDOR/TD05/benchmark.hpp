@@ -0,0 +1,43 @@
+#pragma once
+
+#include "elements.hpp"
+#include "renderer.hpp"
+#include "helpers/RootDir.hpp"
+#include <string>
+#include <vector>
+
+/* Options of the --headless mode */
+class BenchmarkOptions
+{
+public:
+    int frames = 600;
+    int width = 1500;
+    int height = 800;
+    std::string csvPath = BUILD_DIR "benchmark.csv";
+    bool sceneCache = false;
+    bool governor = false;    // adapt the quality to a 60 Hz budget
+    std::string governorLog;  // CSV of the governor decisions, none if empty
+    bool perfCounters = false; // hardware counters around the measured regions
+    bool simulationOnly = false; // frames are simulation ticks, nothing is drawn
+    std::string jsonPath;        // metrics of the run, none if empty
+    std::string baselinePath;    // baseline the metrics are compared with, none if empty
+    double toleranceScale = 1.;  // multiplies the tolerances of the baseline
+};
+
+/* Per frame timings, in milliseconds (gpu is negative when not measured) */
+class FrameTiming
+{
+public:
+    double simulation;
+    double cpu;   // draw submission
+    double gpu;   // between GL_TIMESTAMP queries around the draw
+    double frame; // whole frame, including glFinish
+};
+
+// Nearest-rank percentile (p in [0, 100]) of values
+double percentile(std::vector<double> values, double p);
+
+// Play the scripted run and write the timings to options.csvPath.
+// A GL context must be current unless the renderer is the null one.
+// Returns 0 on success, 1 if a metric regressed from options.baselinePath.
+int runHeadlessBenchmark(Renderer &renderer, Game &game, const BenchmarkOptions &options);
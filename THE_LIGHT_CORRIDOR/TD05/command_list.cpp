@@ -0,0 +1,64 @@
+#include "command_list.hpp"
+#include "renderer.hpp"
+
+void CommandList::clear()
+{
+    opcodes.clear();
+    arguments.clear();
+}
+
+void CommandList::multMatrix(const float mat[16])
+{
+    opcodes.push_back(MULT_MATRIX);
+    arguments.insert(arguments.end(), mat, mat + 16);
+}
+
+void CommandList::setColor(float r, float g, float b, float a)
+{
+    opcodes.push_back(SET_COLOR);
+    arguments.push_back(r);
+    arguments.push_back(g);
+    arguments.push_back(b);
+    arguments.push_back(a);
+}
+
+void CommandList::setLineWidth(float width)
+{
+    opcodes.push_back(SET_LINE_WIDTH);
+    arguments.push_back(width);
+}
+
+void CommandList::replay(Renderer &renderer) const
+{
+    const float *argument = arguments.data();
+    for (size_t i = 0; i < opcodes.size(); i++)
+    {
+        switch (opcodes[i])
+        {
+        case PUSH_MATRIX:
+            renderer.pushMatrix();
+            break;
+        case POP_MATRIX:
+            renderer.popMatrix();
+            break;
+        case MULT_MATRIX:
+            renderer.multMatrix(argument);
+            argument += 16;
+            break;
+        case SET_COLOR:
+            renderer.setColor(argument[0], argument[1], argument[2], argument[3]);
+            argument += 4;
+            break;
+        case SET_LINE_WIDTH:
+            renderer.setLineWidth(argument[0]);
+            argument += 1;
+            break;
+        case DRAW_SQUARE:
+            renderer.drawSquare();
+            break;
+        case DRAW_EMPTY_SQUARE:
+            renderer.drawEmptySquare();
+            break;
+        }
+    }
+}
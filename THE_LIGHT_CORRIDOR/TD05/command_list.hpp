@@ -0,0 +1,42 @@
+#pragma once
+
+#include <vector>
+
+class Renderer;
+
+/* Draw commands recorded without touching GL, so any thread can build one.
+   The list mirrors the Renderer calls used by the scene; replay() sends them
+   to a renderer on the GL thread in recording order. Commands are trusted:
+   the only check at replay is the opcode switch. */
+class CommandList
+{
+public:
+    void clear();
+    bool empty() const { return opcodes.empty(); }
+    int size() const { return opcodes.size(); }
+
+    void pushMatrix() { opcodes.push_back(PUSH_MATRIX); }
+    void popMatrix() { opcodes.push_back(POP_MATRIX); }
+    void multMatrix(const float mat[16]);
+    void setColor(float r, float g, float b, float a = 1.f);
+    void setLineWidth(float width);
+    void drawSquare() { opcodes.push_back(DRAW_SQUARE); }
+    void drawEmptySquare() { opcodes.push_back(DRAW_EMPTY_SQUARE); }
+
+    void replay(Renderer &renderer) const;
+
+private:
+    enum OPCODES
+    {
+        PUSH_MATRIX,
+        POP_MATRIX,
+        MULT_MATRIX,      // 16 floats
+        SET_COLOR,        // 4 floats
+        SET_LINE_WIDTH,   // 1 float
+        DRAW_SQUARE,
+        DRAW_EMPTY_SQUARE
+    };
+
+    std::vector<unsigned char> opcodes;
+    std::vector<float> arguments; // consumed in order by the opcodes taking floats
+};
@@ -1,6 +1,13 @@
 #include "draw_scene.hpp"
 #include "3D_tools.hpp"
+#include "transform.hpp"
+#include "command_list.hpp"
+#include "worker_pool.hpp"
+#include "profiler.hpp"
+#include "memory_tracker.hpp"
+#include "perf_counters.hpp"
 #include <vector>
+#include <cmath>
 
 // Corridor colors
 
@@ -23,6 +30,7 @@ Color color_obstacle = color_left_right;
 
 void drawFrame()
 {
+	PROFILE_ZONE("drawFrame");
 	glBegin(GL_LINES);
 	glColor3f(1.0, 0.0, 0.0);
 	glVertex3f(0.0, 0.0, 0.0);
@@ -36,123 +44,282 @@ void drawFrame()
 	glEnd();
 }
 
+/* Transform hierarchy: the corridor pieces are static nodes built once per
+   level, the ball and the racket nodes only change when they move */
+
+class CorridorPiece
+{
+public:
+	int node;
+	Color color;
+	float alpha;
+	bool outline; // drawEmptySquare instead of drawSquare
+	float nearY;  // closest y of the piece, for the draw distance
+};
+
+static TransformTree corridorTree;
+static std::vector<CorridorPiece> corridorPieces;
+static int corridorGeneration = -1;
+
+/* Parallel recording: the pieces are cut in chunks (the obstacles, then
+   SECTIONS_PER_CHUNK sections each), every chunk is recorded in its own
+   command list by the workers and the lists are replayed in order */
+static const int SECTIONS_PER_CHUNK = 2;
+static std::vector<int> chunkStarts; // first piece of each chunk, then the number of pieces
+static int wallChunk = 0; // first chunk of the walls, the ones before hold the obstacles
+static std::vector<CommandList> chunkLists;
+static WorkerPool *recordWorkers = NULL; // NULL: the GL thread draws directly
+
+static int drawSections = 0; // sections drawn ahead of the player, 0: all
+
+static RacketLatch racketLatch = NULL;
+
+static TransformTree objectTree;
+static int ballNode = -1;
+static int playerNode = -1;
+static int racketNode = -1;
+
+static void addPiece(int node, Color color, float alpha, bool outline)
+{
+	// The unit square spans [-0.5, 0.5] along its local y
+	const Mat4 &local = corridorTree.local(node);
+	CorridorPiece piece = {node, color, alpha, outline, local.m[13] - std::abs(local.m[5]) / 2};
+	corridorPieces.push_back(piece);
+}
+
+// Close the current chunk
+static void endChunk()
+{
+	if (chunkStarts.back() != (int)corridorPieces.size())
+	{
+		chunkStarts.push_back(corridorPieces.size());
+	}
+}
+
+// Target is a Renderer or a CommandList, they share the calls used here
+template <class Target>
+static void drawPiece(Target &target, const CorridorPiece &piece)
+{
+	target.pushMatrix();
+	target.multMatrix(corridorTree.world(piece.node).data());
+	target.setColor(piece.color.r, piece.color.g, piece.color.b, piece.alpha);
+	if (piece.outline)
+	{
+		target.drawEmptySquare();
+	}
+	else
+	{
+		target.drawSquare();
+	}
+	target.popMatrix();
+}
+
+// Obstacles first then, for each section, the four walls and the section frame
+static void buildCorridorTree(const Corridor &corridor)
+{
+	corridorTree.clear();
+	corridorPieces.clear();
+	chunkStarts.assign(1, 0);
+	int root = corridorTree.addNode(TransformTree::NO_PARENT, Mat4::identity());
+
+	for (const Obstacle &obstacle : corridor.obstacles)
+	{
+		Mat4 local = Mat4::translation(toDouble(obstacle.pos.x + obstacle.width / 2), toDouble(obstacle.pos.y), toDouble(obstacle.pos.z - obstacle.height / 2)) *
+					 Mat4::scaling(toDouble(obstacle.width), 1, toDouble(obstacle.height)) *
+					 Mat4::rotation(90, 1, 0, 0);
+		addPiece(corridorTree.addNode(root, local), color_obstacle, 0.5, false);
+	}
+	endChunk();
+	wallChunk = chunkStarts.size() - 1;
+
+	float width = toDouble(corridor.width);
+	float height = toDouble(corridor.height);
+	for (int i = 0; i < corridor.sections; i++)
+	{
+		double y = i * corridor.sections + corridor.sections;
+		float posY1 = y - corridor.sections / 2;
+		float posY2 = y;
+		float posZ1 = height / 2;
+		float posZ2 = -height / 2;
+		Mat4 floorScale = Mat4::scaling(width, corridor.sections, height);
+		Mat4 sideScale = Mat4::rotation(90, 0, 1, 0) * Mat4::scaling(height, corridor.sections, width);
+
+		// UP and DOWN walls
+		addPiece(corridorTree.addNode(root, Mat4::translation(0, posY1, posZ1) * floorScale), color_up_down, 1, false);
+		addPiece(corridorTree.addNode(root, Mat4::translation(0, posY1, posZ2) * floorScale), color_up_down, 1, false);
+
+		// LEFT and RIGHT walls
+		addPiece(corridorTree.addNode(root, Mat4::translation(-width / 2, posY1, 0) * sideScale), color_left_right, 1, false);
+		addPiece(corridorTree.addNode(root, Mat4::translation(width / 2, posY1, 0) * sideScale), color_left_right, 1, false);
+
+		// SECTION frame
+		Mat4 frame = Mat4::translation(0, posY2, 0) * Mat4::scaling(width, 1, height) * Mat4::rotation(90, 1, 0, 0);
+		addPiece(corridorTree.addNode(root, frame), Color(255., 255., 255.), 1, true);
+
+		if ((i + 1) % SECTIONS_PER_CHUNK == 0)
+		{
+			endChunk();
+		}
+	}
+	endChunk();
+	chunkLists.resize(chunkStarts.size() - 1);
+	corridorTree.update();
+}
+
+static void buildObjectTree()
+{
+	ballNode = objectTree.addNode(TransformTree::NO_PARENT, Mat4::identity());
+	playerNode = objectTree.addNode(TransformTree::NO_PARENT, Mat4::identity());
+	racketNode = objectTree.addNode(playerNode, Mat4::rotation(90, 1, 0, 0)); // the square faces the corridor
+}
+
+// Level of detail of the ball, kept between frames
+static LodState ballLod;
+
 // Draw Ball (= sphere)
-void drawBall(Ball ball)
+void drawBall(Renderer &renderer, const Ball &ball, const Vec3s &pos)
 {
-	glPushMatrix();
-	glColor3f(60. / 255., 60. / 255., 60. / 255.); // dark grey
-	glTranslatef(ball.pos.x, ball.pos.y, ball.pos.z);
-	glScalef(ball.radius, ball.radius, ball.radius);
-	drawSphere();
-	glPopMatrix();
+	PROFILE_ZONE("drawBall");
+	PERF_REGION("drawBall");
+	if (ballNode < 0)
+	{
+		buildObjectTree();
+	}
+	objectTree.setLocal(ballNode, Mat4::translation(toDouble(pos.x), toDouble(pos.y), toDouble(pos.z)) * Mat4::scaling(toDouble(ball.radius), toDouble(ball.radius), toDouble(ball.radius)));
+	objectTree.update();
+
+	renderer.pushMatrix();
+	renderer.setColor(60. / 255., 60. / 255., 60. / 255.); // dark grey
+	renderer.multMatrix(objectTree.world(ballNode).data());
+	renderer.drawSphere(&ballLod);
+	renderer.popMatrix();
 }
 
 // Draw the Racket (= square)
-void drawPlayer(Player player)
+void drawPlayer(Renderer &renderer, const Player &player, const Vec3s &pos)
 {
-	glPushMatrix();
-	glTranslatef(0, player.pos.y, 0);
-	glTranslatef(player.pos.x, 0, player.pos.z);
-	glScalef(player.size, 1, player.size);
-	glRotatef(90, 1, 0, 0);
+	PROFILE_ZONE("drawPlayer");
+	PERF_REGION("drawPlayer");
+	if (playerNode < 0)
+	{
+		buildObjectTree();
+	}
+	objectTree.setLocal(playerNode, Mat4::translation(toDouble(pos.x), toDouble(pos.y), toDouble(pos.z)) * Mat4::scaling(toDouble(player.size), 1, toDouble(player.size)));
+	objectTree.update();
+
+	renderer.pushMatrix();
+	renderer.multMatrix(objectTree.world(racketNode).data());
 
 	// DRAW BORDER OF RACKET
-	glColor3f(1., 1., 1.);
-	glLineWidth(2.0);
-	drawEmptySquare();
+	renderer.setColor(1., 1., 1.);
+	renderer.setLineWidth(2.0);
+	renderer.drawEmptySquare();
 
 	// DRAW INSIDE OF RACKET (TRANSPARENCY)
-	glColor4f(1., 1., 1., .25);
-	drawSquare();
+	renderer.setColor(1., 1., 1., .25);
+	renderer.drawSquare();
 
-	glPopMatrix();
+	renderer.popMatrix();
 }
 
-// Draw all obstacles in corridor
-void drawObstacles(std::vector<Obstacle> obstacles, Color color)
+// draw the corridor : obstacles, walls, sections (nodes rebuilt when a level is loaded)
+void drawCorridor(Renderer &renderer, const Game &game, int parts)
 {
-	for (Obstacle obstacle : obstacles)
+	PROFILE_ZONE("drawCorridor");
+	PERF_REGION("drawCorridor");
+	if (corridorGeneration != game.generation)
+	{
+		buildCorridorTree(game.corridor);
+		corridorGeneration = game.generation;
+	}
+
+	double farY = drawSections > 0 ? toDouble(game.currentPos) + drawSections * game.corridor.sections : HUGE_VAL;
+	int firstChunk = (parts & CORRIDOR_OBSTACLES) ? 0 : wallChunk;
+	int stopChunk = (parts & CORRIDOR_WALLS) ? (int)chunkLists.size() : wallChunk;
+
+	if (!recordWorkers)
+	{
+		for (int i = chunkStarts[firstChunk]; i < chunkStarts[stopChunk]; i++)
+		{
+			if (corridorPieces[i].nearY <= farY)
+			{
+				drawPiece(renderer, corridorPieces[i]);
+			}
+		}
+		return;
+	}
+
+	recordWorkers->run(stopChunk - firstChunk, [farY, firstChunk](int index)
+					   {
+						   PROFILE_ZONE("record chunk");
+						   MEMORY_TAG(MEMORY_TAG_RENDERING);
+						   int chunk = firstChunk + index;
+						   CommandList &list = chunkLists[chunk];
+						   list.clear();
+						   for (int i = chunkStarts[chunk]; i < chunkStarts[chunk + 1]; i++)
+						   {
+							   if (corridorPieces[i].nearY <= farY)
+							   {
+								   drawPiece(list, corridorPieces[i]);
+							   }
+						   }
+					   });
+	PROFILE_ZONE("replay");
+	for (int chunk = firstChunk; chunk < stopChunk; chunk++)
 	{
-		glPushMatrix();
-		glTranslatef(0, obstacle.pos.y, 0);
-		glTranslatef(obstacle.pos.x, 0, obstacle.pos.z);
-		glTranslatef((obstacle.width) / 2, 0, -(obstacle.height) / 2);
-		glScalef(obstacle.width, 1, obstacle.height);
-		glRotatef(90, 1, 0, 0);
-		glColor4f(color.r, color.g, color.b, 0.5);
-		drawSquare();
-		glPopMatrix();
+		chunkLists[chunk].replay(renderer);
 	}
 }
 
-// Draw the corridor with all sections
-void drawSections(Corridor corridor)
+void setRecordThreads(int threads)
 {
-	for (int i = 0; i < corridor.sections; i++)
+	delete recordWorkers;
+	recordWorkers = threads > 0 ? new WorkerPool(threads) : NULL;
+}
+
+void setDrawDistance(int sections)
+{
+	drawSections = sections;
+}
+
+int drawDistance()
+{
+	return drawSections;
+}
+
+void setRacketLatch(RacketLatch latch)
+{
+	racketLatch = latch;
+}
+
+void latchPositions(const Game &game, Vec3s *ball, Vec3s *racket)
+{
+	*racket = game.player.pos;
+	if (racketLatch)
 	{
-		double y = i * corridor.sections + corridor.sections;
-		float posX = 0;
-		float posY1 = y - corridor.sections / 2;
-		float posY2 = y;
-		float posZ1 = corridor.height / 2;
-		float posZ2 = -corridor.height / 2;
-
-		// Draw UP wall
-		glPushMatrix();
-		glTranslatef(posX, posY1, posZ1);
-		glScalef(corridor.width, corridor.sections, corridor.height);
-		glColor3f(color_up_down.r, color_up_down.g, color_up_down.b);
-		drawSquare();
-		glPopMatrix();
-
-		// Draw DOWN wall
-		glPushMatrix();
-		glTranslatef(posX, posY1, posZ2);
-		glScalef(corridor.width, corridor.sections, corridor.height);
-		glColor3f(color_up_down.r, color_up_down.g, color_up_down.b);
-		drawSquare();
-		glPopMatrix();
-
-		// Draw LEFT wall
-		posX = -corridor.width / 2;
-		float posZ3 = 0;
-		glPushMatrix();
-		glTranslatef(posX, posY1, posZ3);
-		glRotatef(90, 0, 1, 0);
-		glScalef(corridor.height, corridor.sections, corridor.width);
-		glColor3f(color_left_right.r, color_left_right.g, color_left_right.b);
-		drawSquare();
-		glPopMatrix();
-
-		// Draw RIGHT wall
-		posX = corridor.width / 2;
-		glPushMatrix();
-		glTranslatef(posX, posY1, posZ3);
-		glRotatef(90, 0, 1, 0);
-		glScalef(corridor.height, corridor.sections, corridor.width);
-		glColor3f(color_left_right.r, color_left_right.g, color_left_right.b);
-		drawSquare();
-		glPopMatrix();
-
-		// Draw SECTIONS
-		glPushMatrix();
-		glTranslatef(0, posY2, 0);
-		glScalef(corridor.width, 1, corridor.height);
-		glRotatef(90, 1, 0, 0);
-		glColor4f(255., 255., 255., 1.);
-		drawEmptySquare();
-		glPopMatrix();
+		racketLatch(racket);
+	}
+	// A ball not thrown yet follows the racket, as the racket input does in the simulation
+	*ball = game.ball.pos;
+	if (!game.ball.isThrown)
+	{
+		ball->x = racket->x;
+		ball->z = racket->z;
 	}
 }
 
-// draw the corridor : walls, sections, obstacles
-void drawCorridor(Corridor corridor)
+// draw the whole scene of an ongoing game, the corridor scrolls with currentPos
+void drawGame(Renderer &renderer, const Game &game)
 {
-	glPushMatrix();
-	glTranslatef(0, corridor.sections + corridor.sections * (SECTIONS - 1) - 1. / 100, 0);
-	glScalef(corridor.width, 1, corridor.height);
-	glRotatef(90., 1., 0., 0.);
-	glPopMatrix();
-	drawObstacles(corridor.obstacles, color_obstacle);
-	drawSections(corridor);
+	PROFILE_ZONE("drawGame");
+	PERF_REGION("drawGame");
+	Vec3s ball, racket;
+	latchPositions(game, &ball, &racket);
+
+	renderer.pushMatrix();
+	renderer.translate(0, -toDouble(game.currentPos), 0);
+	drawBall(renderer, game.ball, ball);
+	drawCorridor(renderer, game);
+	renderer.popMatrix();
+	drawPlayer(renderer, game.player, racket);
 }
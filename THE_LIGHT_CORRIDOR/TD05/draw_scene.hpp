@@ -1,6 +1,7 @@
 #pragma once
 
 #include "elements.hpp"
+#include "renderer.hpp"
 
 #include <GL/gl.h>
 #include <GL/glu.h>
@@ -13,10 +14,37 @@ extern Game game;
 
 void drawFrame();
 
-void drawBall(Ball ball);
+// pos: where to draw the ball / racket (late latched position or the simulated one)
+void drawBall(Renderer &renderer, const Ball &ball, const Vec3s &pos);
 
-void drawPlayer(Player player);
+void drawPlayer(Renderer &renderer, const Player &player, const Vec3s &pos);
 
-void drawCorridor(Corridor corridor);
+// Parts of the corridor: the translucent obstacles, the opaque walls and section frames
+enum CorridorParts
+{
+    CORRIDOR_OBSTACLES = 1,
+    CORRIDOR_WALLS = 2,
+    CORRIDOR_ALL = CORRIDOR_OBSTACLES | CORRIDOR_WALLS
+};
 
+void drawCorridor(Renderer &renderer, const Game &game, int parts = CORRIDOR_ALL);
 
+void drawGame(Renderer &renderer, const Game &game);
+
+// Record the corridor draw commands in parallel on that many worker threads
+// (the GL thread helps) then replay them on the GL thread; 0 draws directly
+void setRecordThreads(int threads);
+
+// Only draw the corridor pieces starting less than that many sections ahead
+// of the player; 0 draws the whole corridor (default)
+void setDrawDistance(int sections);
+int drawDistance();
+
+// Called by drawGame() with the simulated racket position, to replace it
+// with the latest input just before drawing (late latching); the ball not
+// thrown yet is drawn on the latched racket too. NULL: none
+typedef void (*RacketLatch)(Vec3s *racket);
+void setRacketLatch(RacketLatch latch);
+
+// Positions to draw the ball and the racket at, latched once per frame
+void latchPositions(const Game &game, Vec3s *ball, Vec3s *racket);
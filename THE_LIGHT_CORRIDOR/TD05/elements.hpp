@@ -5,11 +5,24 @@
 #include <GL/glu.h>
 #include <vector>
 #include <cstdlib>
+#include <algorithm>
 #include <cmath>
+#include <random>
+#include <type_traits>
+#include <cassert>
+
+#include "profiler.hpp"
+#include "logger.hpp"
+#include "memory_tracker.hpp"
+#include "perf_counters.hpp"
+#include "arena.hpp"
+#include "fixed_point.hpp"
+#include "math3d.hpp"
 
 static const double CORRIDOR_WIDTH = 25.;
 static const double CORRIDOR_HEIGHT = 15.;
 static const int SECTIONS = 10.;
+static const int MAX_OBSTACLES = SECTIONS; // of a corridor, what a snapshot can hold
 
 enum GAME_STATES
 {
@@ -18,18 +31,8 @@ enum GAME_STATES
     WIN
 };
 
-class Position
-{
-public:
-    double x, y, z;
-
-    Position() = default;
-
-    Position(double _x, double _y, double _z)
-        : x{_x}, y{_y}, z{_z}
-    {
-    }
-};
+// Positions and speeds, in the number type of the simulation
+typedef Vec3<Scalar> Vec3s;
 
 class Color
 {
@@ -47,15 +50,15 @@ public:
 class Player
 {
 public:
-    double size; // racket is a square
-    Position pos;
+    Scalar size; // racket is a square
+    Vec3s pos;
     bool bonusStick = false;  // stick
     bool bonusLife = false;  // ++ life
 
     Player() = default;
 
-    Player(float _size)
-        : size(_size), pos{0, 0, 0}
+    Player(Scalar _size)
+        : size(_size), pos{Scalar(0), Scalar(0), Scalar(0)}
     {
     }
 };
@@ -63,13 +66,13 @@ public:
 class Obstacle
 {
 public:
-    float width;
-    float height;
-    Position pos;
+    Scalar width;
+    Scalar height;
+    Vec3s pos;
 
     Obstacle() = default;
 
-    Obstacle(float _width, float _height, Position _pos)
+    Obstacle(Scalar _width, Scalar _height, Vec3s _pos)
         : width{_width}, height{_height}, pos{_pos}
     {
     }
@@ -77,43 +80,52 @@ public:
 
 class Bonus
 {
-    float size;
+    Scalar size;
     int type;
-    Position pos;
+    Vec3s pos;
 
     Bonus() = default;
 
-    Bonus(float _size, int _type, Position _pos)
+    Bonus(Scalar _size, int _type, Vec3s _pos)
         : size{_size}, type{_type}, pos{_pos} {}
 };
 
+// Per level containers take their memory from the level arena of Game
+typedef std::vector<Obstacle, ArenaAllocator<Obstacle>> ObstacleList;
+
 class Corridor
 {
 public:
-    double width;
-    double height;
+    Scalar width;
+    Scalar height;
     int sections;
-    std::vector<Obstacle> obstacles;
+    ObstacleList obstacles;
 
     Corridor() = default;
 
-    Corridor(double _width, double _height, int _sections)
-        : width{_width}, height{_height}, sections{_sections}
+    Corridor(Scalar _width, Scalar _height, int _sections, MonotonicArena *levelArena)
+        : width{_width}, height{_height}, sections{_sections}, obstacles{ArenaAllocator<Obstacle>(levelArena)}
     {
     }
 
-    void generateCorridor()
+    // Same seed, same obstacles (the corridor has its own generator)
+    void generateCorridor(unsigned int seed)
     {
+        PERF_REGION("generateCorridor");
+        std::minstd_rand random(seed);
+        // at most two obstacles every two sections
+        assert(sections / 2 * 2 <= MAX_OBSTACLES);
+        obstacles.reserve(sections);
         for (int i = 0; i < sections / 2; i++)
         {
             double y = i * sections + sections; // profondeur
-            int randomObstacleType = rand() % 6;
+            int randomObstacleType = random() % 6;
 
             switch (randomObstacleType)
             {
             case 0: // BIG OBSTACLE LEFT
             {
-                Position position = Position(-width / 2, y * 2, height / 2);
+                Vec3s position = Vec3s(-width / 2, Scalar(y * 2), height / 2);
                 Obstacle obstacle = Obstacle(width / 2, height, position);
                 obstacles.push_back(obstacle);
                 break;
@@ -121,7 +133,7 @@ public:
 
             case 1: // BIG OBSTACLE RIGHT
             {
-                Position position = Position(0, y * 2, height / 2);
+                Vec3s position = Vec3s(Scalar(0), Scalar(y * 2), height / 2);
                 Obstacle obstacle = Obstacle(width / 2, height, position);
                 obstacles.push_back(obstacle);
                 break;
@@ -129,7 +141,7 @@ public:
 
             case 2: // SMALL OBSTACLE LEFT
             {
-                Position position = Position(-width / 2 * 2, y, height / 2);
+                Vec3s position = Vec3s(-width / 2 * 2, Scalar(y), height / 2);
                 Obstacle obstacle = Obstacle(width / 4, height, position);
                 obstacles.push_back(obstacle);
                 break;
@@ -137,7 +149,7 @@ public:
 
             case 3: // SMALL OBSTACLE RIGHT
             {
-                Position position = Position(width / 4, y * 2, height / 2);
+                Vec3s position = Vec3s(width / 4, Scalar(y * 2), height / 2);
                 Obstacle obstacle = Obstacle(width / 4, height, position);
                 obstacles.push_back(obstacle);
                 break;
@@ -145,10 +157,10 @@ public:
 
             default: // TWO LITTLE OBSTACLES LEFT-RIGHT
             {
-                Position position = Position(width / 4, y * 2, height / 2);
+                Vec3s position = Vec3s(width / 4, Scalar(y * 2), height / 2);
                 Obstacle obstacle = Obstacle(width / 4, height, position);
                 obstacles.push_back(obstacle);
-                Position position2 = Position(-width / 2, y * 2, height / 2);
+                Vec3s position2 = Vec3s(-width / 2, Scalar(y * 2), height / 2);
                 Obstacle obstacle2 = Obstacle(width / 4, height, position2);
                 obstacles.push_back(obstacle2);
                 break;
@@ -161,99 +173,102 @@ public:
 class Ball
 {
 public:
-    float radius;
-    Position pos;
-    float defaultSpeed;
-    Position speed;
+    Scalar radius;
+    Vec3s pos;
+    Scalar defaultSpeed;
+    Vec3s speed;
     bool isThrown;
+    int obstaclesTested = 0; // by the last checkCollisions()
 
     Ball() {}
 
-    Ball(float rad, float speed)
-        : radius{rad}, pos{Position(0, rad + 1, 0)}, defaultSpeed{speed}, speed{Position(0, speed, 0)}, isThrown{false}
+    Ball(Scalar rad, Scalar speed)
+        : radius{rad}, pos{Vec3s(Scalar(0), rad + Scalar(1), Scalar(0))}, defaultSpeed{speed}, speed{Vec3s(Scalar(0), speed, Scalar(0))}, isThrown{false}
     {
     }
 
     // Check all possible collisions of the ball
-    void checkCollisions(Corridor corridor, Player player, double currentPos)
+    void checkCollisions(const Corridor &corridor, const Player &player, Scalar currentPos)
     {
+        PROFILE_ZONE("checkCollisions");
+        PERF_REGION("checkCollisions");
+        obstaclesTested = 0;
         obstacleCollision(corridor.obstacles);
         racketCollision(player, currentPos);
         wallCollision(corridor);
     }
 
 private:
-    void obstacleCollision(std::vector<Obstacle> obstacles)
+    // Half size of the bounding box of the ball
+    Vec3s extent() const
+    {
+        return Vec3s(radius, radius, radius);
+    }
+
+    void obstacleCollision(const ObstacleList &obstacles)
     {
-        for (Obstacle obstacle : obstacles)
+        // NEW BALL BORDER, moved again when a rebound changes the speed
+        Vec3s ballMin = pos + speed - extent();
+        Vec3s ballMax = pos + speed + extent();
+        for (const Obstacle &obstacle : obstacles)
         {
-            // NEW BALL POSITION
-            float nextX = pos.x + speed.x;
-            float nextY = pos.y + speed.y;
-            float nextZ = pos.z + speed.z;
-
-            // REBOUND
-            float ballMinX = nextX - radius;
-            float ballMaxX = nextX + radius;
-            float ballMinY = nextY - radius;
-            float ballMaxY = nextY + radius;
-            float ballMinZ = nextZ - radius;
-            float ballMaxZ = nextZ + radius;
+            obstaclesTested++;
+            bool rebound = false;
 
             // SIDE COLLISION
             if (pos.y + radius >= obstacle.pos.y && pos.y - radius <= obstacle.pos.y &&
-                ballMaxX >= obstacle.pos.x && ballMinX <= obstacle.pos.x + obstacle.width)
+                ballMax.x >= obstacle.pos.x && ballMin.x <= obstacle.pos.x + obstacle.width)
             {
-                speed.x = -speed.x;
+                speed = reflect(speed, Vec3s::unitX());
+                rebound = true;
             }
 
             // OBSTACLES COLLISION
-            if (ballMaxX >= obstacle.pos.x && ballMinX <= obstacle.pos.x + obstacle.width &&
-                ballMaxY >= obstacle.pos.y && ballMinY <= obstacle.pos.y &&
-                ballMinZ >= obstacle.pos.z - obstacle.height && ballMaxZ <= obstacle.pos.z)
+            if (ballMax.x >= obstacle.pos.x && ballMin.x <= obstacle.pos.x + obstacle.width &&
+                ballMax.y >= obstacle.pos.y && ballMin.y <= obstacle.pos.y &&
+                ballMin.z >= obstacle.pos.z - obstacle.height && ballMax.z <= obstacle.pos.z)
             {
-                speed.y = -speed.y;
+                speed = reflect(speed, Vec3s::unitY());
+                rebound = true;
+            }
+
+            if (rebound)
+            {
+                ballMin = pos + speed - extent();
+                ballMax = pos + speed + extent();
             }
         }
     }
 
-    void racketCollision(Player player, double currentPos)
+    void racketCollision(const Player &player, Scalar currentPos)
     {
-        // BALL POSITION
-        float nextX = pos.x + speed.x;
-        float nextY = pos.y + speed.y;
-        float nextZ = pos.z + speed.z;
-
-        // BALL BORDER
-        float ballMinX = nextX - radius;
-        float ballMaxX = nextX + radius;
-        float ballMinY = nextY - radius;
-        float ballMaxY = nextY + radius;
-        float ballMinZ = nextZ - radius;
-        float ballMaxZ = nextZ + radius;
+        // BALL POSITION AND BORDER
+        Vec3s next = pos + speed;
+        Vec3s ballMin = next - extent();
+        Vec3s ballMax = next + extent();
 
         // CHECK RACKET COLLISION
-        if (ballMaxX >= player.pos.x - player.size / 2 && ballMinX <= player.pos.x + player.size / 2 &&
-            ballMaxY >= player.pos.y + currentPos && ballMinY <= player.pos.y + currentPos &&
-            ballMaxZ >= player.pos.z - player.size / 2 && ballMinZ <= player.pos.z + player.size / 2)
+        if (ballMax.x >= player.pos.x - player.size / 2 && ballMin.x <= player.pos.x + player.size / 2 &&
+            ballMax.y >= player.pos.y + currentPos && ballMin.y <= player.pos.y + currentPos &&
+            ballMax.z >= player.pos.z - player.size / 2 && ballMin.z <= player.pos.z + player.size / 2)
         {
             if (player.bonusStick) {
                 // THE BALL STICK TO THE RACKET
-                pos = Position(player.pos.x, radius + currentPos + 1, player.pos.z);
-                speed = Position(0, defaultSpeed, 0);
+                pos = Vec3s(player.pos.x, radius + currentPos + Scalar(1), player.pos.z);
+                speed = Vec3s(Scalar(0), defaultSpeed, Scalar(0));
                 isThrown = false;
             }
             else {
                 // REBOND
-                const double MAX_SPEED = std::abs(speed.y);
+                const Scalar MAX_SPEED = speed.y < Scalar(0) ? -speed.y : speed.y;
 
                 // DISTANCE CENTER RACKET - BALL
-                float distanceFromCenterX = pos.x - player.pos.x;
-                float distanceFromCenterZ = pos.z - player.pos.z;
+                Scalar distanceFromCenterX = pos.x - player.pos.x;
+                Scalar distanceFromCenterZ = pos.z - player.pos.z;
 
                 // REBOUND DIRECTION
-                float reboundDirectionX = distanceFromCenterX / (player.size / 2);
-                float reboundDirectionZ = distanceFromCenterZ / (player.size / 2);
+                Scalar reboundDirectionX = distanceFromCenterX / (player.size / 2);
+                Scalar reboundDirectionZ = distanceFromCenterZ / (player.size / 2);
 
                 // UPDATE SPEED
                 speed.x = reboundDirectionX * MAX_SPEED;
@@ -268,43 +283,57 @@ private:
         // TODO
     }
 
-    void wallCollision(Corridor corridor)
+    void wallCollision(const Corridor &corridor)
     {
-        // BALL POSITION
-        float nextX = pos.x + speed.x;
-        float nextY = pos.y + speed.y;
-        float nextZ = pos.z + speed.z;
-
-        // BALL BORDER
-        float ballMinX = nextX - radius;
-        float ballMaxX = nextX + radius;
-        float ballMinZ = nextZ - radius;
-        float ballMaxZ = nextZ + radius;
+        // BALL POSITION AND BORDER
+        Vec3s next = pos + speed;
+        Vec3s ballMin = next - extent();
+        Vec3s ballMax = next + extent();
 
         // BALL COLLISION WITH CORRIDOR
-        if (ballMaxX >= corridor.width / 2)
+        if (ballMax.x >= corridor.width / 2)
         {
             pos.x = corridor.width / 2 - radius;
-            speed.x = -speed.x;
+            speed = reflect(speed, Vec3s::unitX());
         }
-        else if (ballMinX <= -corridor.width / 2)
+        else if (ballMin.x <= -corridor.width / 2)
         {
             pos.x = -corridor.width / 2 + radius;
-            speed.x = -speed.x;
+            speed = reflect(speed, Vec3s::unitX());
         }
-        if (ballMaxZ >= corridor.height / 2)
+        if (ballMax.z >= corridor.height / 2)
         {
             pos.z = corridor.height / 2 - radius;
-            speed.z = -speed.z;
+            speed = reflect(speed, Vec3s::unitZ());
         }
-        else if (ballMinZ <= -corridor.height / 2)
+        else if (ballMin.z <= -corridor.height / 2)
         {
             pos.z = -corridor.height / 2 + radius;
-            speed.z = -speed.z;
+            speed = reflect(speed, Vec3s::unitZ());
         }
     }
 };
 
+/* Complete state of a game, trivially copyable: taking or restoring one
+   is a copy of a few hundred bytes, no allocation */
+class GameSnapshot
+{
+public:
+    Player player;
+    Ball ball;
+    Scalar corridorWidth;
+    Scalar corridorHeight;
+    int sections;
+    unsigned int corridorSeed;
+    int obstacleCount;
+    Obstacle obstacles[MAX_OBSTACLES];
+    int life;
+    int score;
+    GAME_STATES gameState;
+    Scalar currentPos;
+};
+static_assert(std::is_trivially_copyable<GameSnapshot>::value, "snapshots are copied as plain memory");
+
 class Game
 {
 public:
@@ -314,20 +343,83 @@ public:
     int life;
     int score;
     GAME_STATES gameState;
-    double currentPos = 0.;
+    Scalar currentPos = Scalar(0);
+    int generation = 0; // incremented by each loadGame() or restore(), tells when the corridor changed
+    unsigned int corridorSeed = 0;
+    MonotonicArena levelArena; // per level data, released at once by loadGame()
 
     Game() = default;
 
+    // New level, its corridor seed drawn from rand()
     void loadGame()
     {
-        corridor = Corridor(CORRIDOR_WIDTH, CORRIDOR_HEIGHT, SECTIONS);
-        player = Player(CORRIDOR_WIDTH / 6);
-        ball = Ball(CORRIDOR_WIDTH / 12, .2);
+        loadGame(rand());
+    }
+
+    void loadGame(unsigned int seed)
+    {
+        MEMORY_TAG(MEMORY_TAG_GENERATION);
+        resetLevel(Scalar(CORRIDOR_WIDTH), Scalar(CORRIDOR_HEIGHT), SECTIONS);
+        player = Player(Scalar(CORRIDOR_WIDTH / 6));
+        ball = Ball(Scalar(CORRIDOR_WIDTH / 12), Scalar(.2));
         life = 5;
         gameState = ONGOING;
-        currentPos = 0;
+        currentPos = Scalar(0);
         score = 0;
-        corridor.generateCorridor();
+        corridorSeed = seed;
+        corridor.generateCorridor(seed);
+        generation++;
+    }
+
+    GameSnapshot snapshot() const
+    {
+        GameSnapshot snapshot;
+        snapshot.player = player;
+        snapshot.ball = ball;
+        snapshot.corridorWidth = corridor.width;
+        snapshot.corridorHeight = corridor.height;
+        snapshot.sections = corridor.sections;
+        snapshot.corridorSeed = corridorSeed;
+        assert(corridor.obstacles.size() <= (size_t)MAX_OBSTACLES);
+        snapshot.obstacleCount = corridor.obstacles.size();
+        std::copy(corridor.obstacles.begin(), corridor.obstacles.begin() + snapshot.obstacleCount, snapshot.obstacles);
+        snapshot.life = life;
+        snapshot.score = score;
+        snapshot.gameState = gameState;
+        snapshot.currentPos = currentPos;
+        return snapshot;
+    }
+
+    // Back to the snapshot state, the obstacles are copied (not regenerated)
+    void restore(const GameSnapshot &snapshot)
+    {
+        MEMORY_TAG(MEMORY_TAG_GENERATION);
+        resetLevel(snapshot.corridorWidth, snapshot.corridorHeight, snapshot.sections);
+        corridor.obstacles.assign(snapshot.obstacles, snapshot.obstacles + snapshot.obstacleCount);
+        player = snapshot.player;
+        ball = snapshot.ball;
+        corridorSeed = snapshot.corridorSeed;
+        life = snapshot.life;
+        score = snapshot.score;
+        gameState = snapshot.gameState;
+        currentPos = snapshot.currentPos;
+        generation++;
+    }
+
+    // ONE SIMULATION TICK: MOVE BALL, COLLISIONS, PLAYER STATE
+    void step()
+    {
+        MEMORY_TAG(MEMORY_TAG_SIMULATION);
+        if (gameState != ONGOING)
+        {
+            return;
+        }
+        if (ball.isThrown)
+        {
+            ball.pos += ball.speed;
+        }
+        ball.checkCollisions(corridor, player, currentPos);
+        playerState();
     }
 
     // PLAYER MOVE FORWARD INSIDE THE CORRIDOR
@@ -335,12 +427,12 @@ public:
     {
         if (racketCanMoveForward(distance, currentPos, corridor.obstacles)) // check if no obstacle in front of the player
         {
-            if ((ball.pos.y - currentPos - distance - 2) > 0)
+            if (ball.pos.y - currentPos - Scalar(distance + 2) > Scalar(0))
             {
-                currentPos += distance;
+                currentPos += Scalar(distance);
                 if (!ball.isThrown)
                 {
-                    ball.pos.y += distance;
+                    ball.pos.y += Scalar(distance);
                 }
                 score += distance * 25;
             }
@@ -350,22 +442,23 @@ public:
     // PLAYER STATE: LOSE LIFE, WIN GAME, LOSE GAME
     void playerState()
     {
-        double corridorEnd = corridor.sections * corridor.sections;
+        PROFILE_ZONE("playerState");
+        Scalar corridorEnd = Scalar(corridor.sections * corridor.sections);
         if (ball.isThrown)
         {
             // BALL BEHIND RACKET
             if (ball.pos.y - ball.radius - currentPos < player.pos.y)
             {
                 life--;
-                std::cout << "CURRENT LIFE: " << life << std::endl;
+                LOG_INFO("CURRENT LIFE: %d", life);
                 if (life == 0)
                 {
                     gameState = LOSE;
                 }
                 else
                 {
-                    ball.pos = Position(player.pos.x, ball.radius + currentPos + 1, player.pos.z);
-                    ball.speed = Position(0, ball.defaultSpeed, 0);
+                    ball.pos = Vec3s(player.pos.x, ball.radius + currentPos + Scalar(1), player.pos.z);
+                    ball.speed = Vec3s(Scalar(0), ball.defaultSpeed, Scalar(0));
                     ball.isThrown = false;
                 }
             }
@@ -378,19 +471,26 @@ public:
     }
 
 private:
+    // Empty corridor, the previous level is dropped before its memory is handed out again
+    void resetLevel(Scalar width, Scalar height, int sections)
+    {
+        corridor = Corridor(width, height, sections, &levelArena);
+        levelArena.reset();
+    }
+
     // Check if player can move forward (no obstacle in front of him)
-    bool racketCanMoveForward(int distance, int currentPos, std::vector<Obstacle> obstacles)
+    bool racketCanMoveForward(int distance, Scalar currentPos, const ObstacleList &obstacles)
     {
-        for (Obstacle obstacle : obstacles)
+        for (const Obstacle &obstacle : obstacles)
         {
             // NEW PLAYER POSITION in y-axis
-            float nextY = player.pos.y + distance;
+            Scalar nextY = player.pos.y + Scalar(distance);
 
             // RACKET BORDER
-            float playerMinX = player.pos.x - player.size / 2;
-            float playerMaxX = player.pos.x + player.size / 2;
-            float playerMinZ = player.pos.z - player.size / 2;
-            float playerMaxZ = player.pos.z + player.size / 2;
+            Scalar playerMinX = player.pos.x - player.size / 2;
+            Scalar playerMaxX = player.pos.x + player.size / 2;
+            Scalar playerMinZ = player.pos.z - player.size / 2;
+            Scalar playerMaxZ = player.pos.z + player.size / 2;
 
             // OBSTACLES COLLISION
             if (playerMaxX >= obstacle.pos.x && playerMinX <= obstacle.pos.x + obstacle.width &&
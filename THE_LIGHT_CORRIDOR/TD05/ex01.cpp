@@ -5,11 +5,22 @@
 #include "glad/glad.h"
 #include <iostream>
 #include <cmath>
+#include <cstring>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 #include "3D_tools.hpp"
 #include "draw_scene.hpp"
+#include "benchmark.hpp"
+#include "rewind.hpp"
+#include "flight_recorder.hpp"
+#include "scene_cache.hpp"
+#include "governor.hpp"
+#include "frame_pacer.hpp"
+#include "profiler.hpp"
+#include "overlay.hpp"
+#include "memory_tracker.hpp"
+#include "logger.hpp"
 
 /* Window properties */
 static const unsigned int WINDOW_WIDTH = 1500;
@@ -18,13 +29,55 @@ static const char WINDOW_TITLE[] = "THE LIGHT CORRIDOR";
 static float aspectRatio = 1.0;
 static const int scalingFactor = 4;
 
-Game game = Game();
+Game game;
+Renderer *renderer = NULL;
+SceneCache *sceneCache = NULL; // only with --scene-cache
+QualityGovernor *governor = NULL; // only with --governor
+PerfOverlay *overlay = NULL;
 
 static const float _viewSize = CORRIDOR_HEIGHT;
 
 /* Minimal time wanted between two images */
 static const double FRAMERATE_IN_SECONDS = 1. / 60.;
 
+/* Chrome trace written by F12 (profiler builds) */
+static std::string traceFile = "trace.json";
+
+/* Dump of the flight recorder (F8 and fatal signals) */
+static std::string flightRecorderFile = "flight_recorder.bin";
+
+/* Checkpoint of F5, restored by F9 (instant retry while the game is on) */
+static GameSnapshot checkpoint;
+static bool hasCheckpoint = false;
+
+/* Render on demand: set by every input, resize or expose event. Once a
+   frame has neither events nor motion, the main loop waits for events */
+static bool redrawNeeded = true;
+
+/* What a frame shows of the game, to tell when the simulation is still */
+class FrameState
+{
+public:
+	GAME_STATES gameState;
+	int generation;
+	double currentPos;
+	Vec3s ball;
+	bool ballThrown;
+	Vec3s player;
+
+	explicit FrameState(const Game &game)
+		: gameState{game.gameState}, generation{game.generation}, currentPos{game.currentPos},
+		  ball{game.ball.pos}, ballThrown{game.ball.isThrown}, player{game.player.pos}
+	{
+	}
+
+	bool operator==(const FrameState &other) const
+	{
+		return gameState == other.gameState && generation == other.generation && currentPos == other.currentPos &&
+			   ball == other.ball && ballThrown == other.ballThrown && player == other.player;
+	}
+};
+
 /* Error handling function */
 void onError(int error, const char *description)
 {
@@ -33,109 +86,445 @@ void onError(int error, const char *description)
 
 void onWindowResized(GLFWwindow *window, int width, int height)
 {
+	redrawNeeded = true;
 	aspectRatio = width / (float)height;
 
-	glViewport(0, 0, width, height);
-	glMatrixMode(GL_PROJECTION);
-	glLoadIdentity();
-	setPerspective(60.0f, aspectRatio, Z_NEAR, Z_FAR);
-	glMatrixMode(GL_MODELVIEW);
-	setCamera();
+	renderer->setViewport(width, height);
+	setPerspective(*renderer, 60.0f, aspectRatio, Z_NEAR, Z_FAR);
+	setCamera(*renderer);
+}
+
+// Gameplay inputs go through the flight recorder, the replay applies them the same way
+static void playerInput(INPUT_EVENTS type, Scalar x = Scalar(0), Scalar z = Scalar(0))
+{
+	recordInput(type, x, z);
+	InputEvent event = {0, type, x, z};
+	applyInput(game, event);
 }
 
 /* MOUSE BUTTON CALLBACK : right click = throw ball / left click = move racket forward */
 void mouse_callback(GLFWwindow *window, int button, int action, int mods)
 {
+	redrawNeeded = true;
 	if (button == GLFW_MOUSE_BUTTON_RIGHT && action == GLFW_PRESS)
 	{
 		if (!game.ball.isThrown)
 		{
-			game.ball.isThrown = true;
+			playerInput(INPUT_THROW);
 		}
 	}
 	else if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS)
 	{
 		if (game.ball.isThrown)
 		{
-			game.moveForward(1);
-			std::cout << "CURRENT SCORE: " << game.score << std::endl;
+			playerInput(INPUT_FORWARD);
+			LOG_INFO("CURRENT SCORE: %d", game.score);
 		}
 	}
 }
 
-// update Position pos in relation with mouse position (posX, posY)
-void updateMousePosition(Position *pos, int posX, int posY, int width, int height, double _viewSize, double aspectRatio, double xLimit, double zLimit)
+// update racket position pos in relation with mouse position (posX, posY)
+void updateMousePosition(Vec3s *pos, int posX, int posY, int width, int height, double _viewSize, double aspectRatio, double xLimit, double zLimit)
+{
+	pos->x = Scalar(std::max(-xLimit / 2, std::min(xLimit / 2, ((_viewSize * aspectRatio) / width * posX - (_viewSize * aspectRatio) / 2.0))));
+	pos->z = Scalar(std::max(-zLimit / 2, std::min(zLimit / 2, (-_viewSize / height * posY + _viewSize / 2.0))));
+}
+
+/* Raw mouse: the cursor is disabled (raw motion is only given for a disabled
+   cursor), its virtual position is kept inside the window */
+static bool rawMouse = false;
+
+static void clampCursor(GLFWwindow *window, double *xpos, double *ypos)
+{
+	double x = std::max(0., std::min((double)WINDOW_WIDTH, *xpos));
+	double y = std::max(0., std::min((double)WINDOW_HEIGHT, *ypos));
+	if (x != *xpos || y != *ypos)
+	{
+		glfwSetCursorPos(window, x, y);
+		*xpos = x;
+		*ypos = y;
+	}
+}
+
+/* Late latching: the racket (and the ball it holds) is drawn at the cursor
+   position read right before drawing, not at the one polled at the start of
+   the frame */
+static GLFWwindow *mainWindow = NULL;
+static FramePacer *framePacer = NULL;
+
+static void latchRacket(Vec3s *racket)
 {
-	pos->x = std::max(-xLimit / 2, std::min(xLimit / 2, ((_viewSize * aspectRatio) / width * posX - (_viewSize * aspectRatio) / 2.0)));
-	pos->z = std::max(-zLimit / 2, std::min(zLimit / 2, (-_viewSize / height * posY + _viewSize / 2.0)));
+	if (game.gameState != ONGOING)
+	{
+		return;
+	}
+	double xpos, ypos;
+	glfwGetCursorPos(mainWindow, &xpos, &ypos);
+	if (rawMouse)
+	{
+		clampCursor(mainWindow, &xpos, &ypos);
+	}
+	updateMousePosition(racket, xpos, ypos, WINDOW_WIDTH, WINDOW_HEIGHT, _viewSize, aspectRatio, CORRIDOR_WIDTH - toDouble(game.player.size), CORRIDOR_HEIGHT - toDouble(game.player.size));
+	framePacer->inputLatched();
 }
 
 /* CURSOR CALLBAK: Move racket followed by cursor position */
 void cursor_callback(GLFWwindow *window, double xpos, double ypos)
 {
-	// move racket
-	updateMousePosition(&game.player.pos, xpos, ypos, WINDOW_WIDTH, WINDOW_HEIGHT, _viewSize, aspectRatio, CORRIDOR_WIDTH - game.player.size, CORRIDOR_HEIGHT - game.player.size);
-
-	// Move ball followed by racket position if not thrown
-	if (!game.ball.isThrown)
+	redrawNeeded = true;
+	if (rawMouse)
 	{
-		updateMousePosition(&game.ball.pos, xpos, ypos, WINDOW_WIDTH, WINDOW_HEIGHT, _viewSize, aspectRatio, CORRIDOR_WIDTH - game.player.size, CORRIDOR_HEIGHT - game.player.size);
+		clampCursor(window, &xpos, &ypos);
 	}
+
+	// move racket, and the ball followed by racket position if not thrown
+	Vec3s racket;
+	updateMousePosition(&racket, xpos, ypos, WINDOW_WIDTH, WINDOW_HEIGHT, _viewSize, aspectRatio, CORRIDOR_WIDTH - toDouble(game.player.size), CORRIDOR_HEIGHT - toDouble(game.player.size));
+	playerInput(INPUT_RACKET, racket.x, racket.z);
 }
 
 void onKey(GLFWwindow *window, int key, int scancode, int action, int mods)
 {
+	redrawNeeded = true;
 	if (action == GLFW_PRESS)
 	{
 		switch (key)
 		{
 		case GLFW_KEY_ESCAPE:
 		case GLFW_KEY_A:
-			std::cout << "QUIT" << std::endl;
+			LOG_INFO("QUIT");
 			glfwSetWindowShouldClose(window, GLFW_TRUE);
 			break;
 
 		case GLFW_KEY_S: // start game
-			std::cout << "START" << std::endl;
+			LOG_INFO("START");
 			game.loadGame();
+			recordJump();
+			break;
+
+		case GLFW_KEY_F5: // save a checkpoint
+			if (game.gameState == ONGOING)
+			{
+				checkpoint = game.snapshot();
+				hasCheckpoint = true;
+				LOG_INFO("CHECKPOINT SAVED (score %d, life %d)", checkpoint.score, checkpoint.life);
+			}
+			break;
+
+		case GLFW_KEY_F9: // back to the checkpoint
+			if (hasCheckpoint)
+			{
+				game.restore(checkpoint);
+				recordJump();
+				LOG_INFO("CHECKPOINT RESTORED (score %d, life %d)", game.score, game.life);
+			}
+			break;
+
+		case GLFW_KEY_F3: // performance overlay
+			overlay->visible = !overlay->visible;
+			break;
+
+		case GLFW_KEY_F8: // flight recorder dump
+			if (dumpFlightRecorder())
+			{
+				LOG_INFO("FLIGHT RECORDER: %s", flightRecorderFile.c_str());
+			}
+			else
+			{
+				LOG_WARNING("Cannot write %s", flightRecorderFile.c_str());
+			}
+			break;
+
+		case GLFW_KEY_F10: // allocations by subsystem
+			printMemoryReport();
+			break;
+
+		case GLFW_KEY_F12: // dump the profiler zones
+			if (profilerWriteTrace(traceFile))
+			{
+				LOG_INFO("TRACE: %s", traceFile.c_str());
+			}
+			else
+			{
+				LOG_WARNING("%s", (profilerEnabled() ? "Cannot write " + traceFile : "Profiler not built (LIGHT_CORRIDOR_PROFILER)").c_str());
+			}
 			break;
 
 		default:
-			std::cout << "Touche non gérée (" << key << ")" << std::endl;
+			LOG_INFO("Touche non gérée (%d)", key);
 			break;
 		}
 	}
 }
 
+// The window content was damaged (uncovered, restored...)
+void onWindowRefresh(GLFWwindow *)
+{
+	redrawNeeded = true;
+}
+
 void draw()
 {
 	switch (game.gameState)
 	{
 	case ONGOING:
-		glPushMatrix();
-		glTranslatef(0, -game.currentPos, 0);
-		drawBall(game.ball);
-		drawCorridor(game.corridor);
-		glPopMatrix();
-		drawPlayer(game.player);
+		if (sceneCache)
+		{
+			sceneCache->draw(*renderer, game);
+		}
+		else
+		{
+			drawGame(*renderer, game);
+		}
 		break;
 
 	// Game Over menu
 	case LOSE:
-		std::cout << "YOU LOSE !" << std::endl;
+		LOG_INFO("YOU LOSE !");
+		printMemoryReport();
+		stopLogger();
 		glfwTerminate();
 		exit(0);
 
 	// Victory menu
 	case WIN:
-		std::cout << "YOU WIN !" << std::endl;
+		LOG_INFO("YOU WIN !");
+		printMemoryReport();
+		stopLogger();
 		glfwTerminate();
 		exit(0);
 	}
 }
 
-int main(int /* argc */, char ** /* argv */)
+void printUsage(const char *program)
+{
+	std::cout << "Usage: " << program << " [--renderer legacy|batched|null] [--ball mesh|impostor] [--lod] [--scene-cache] [--threads N] [--governor] [--governor-log file] [--pacing vsync|limiter|adaptive] [--frame-log file] [--raw-mouse] [--no-latch] [--no-idle] [--trace file] [--overlay] [--stats-csv file] [--stats-interval seconds] [--log file] [--rewind-seconds s] [--flight-recorder file] [--no-flight-recorder] [--seed N]" << std::endl
+			  << "       " << program << " --headless [--frames N] [--csv file] [--renderer ...] [--ball ...] [--lod] [--scene-cache] [--threads N] [--governor] [--governor-log file] [--perf-counters] [--trace file] [--seed N]" << std::endl
+			  << "       " << program << " --replay file" << std::endl
+			  << "       " << program << " --headless [--simulation-only] [--frames N] ... [--json file] [--baseline file] [--tolerance-scale x]" << std::endl;
+}
+
+/* Command line options */
+class Options
 {
+public:
+	RENDERER_BACKENDS backend = RENDERER_LEGACY;
+	bool headless = false;
+	bool ballImpostor = false;
+	bool lod = false;
+	bool hasSeed = false;
+	unsigned int seed = 0;
+	int threads = 0; // command list recording workers
+	PACING_MODES pacing = PACING_LIMITER;
+	bool rawMouse = false;
+	bool lateLatch = true;
+	bool idle = true; // wait for events instead of redrawing a still scene
+	std::string frameLog; // per frame pacing CSV, none if empty
+	std::string trace;    // profiler trace written on exit, none if empty
+	bool overlay = false; // performance overlay shown at startup (F3 toggles it)
+	std::string statsCsv; // overlay counters CSV, none if empty
+	double statsInterval = 1.;
+	std::string log;      // gameplay log file, stdout if empty
+	double rewindSeconds = 10.; // history kept for rewinding (Backspace), 0 for none
+	bool flightRecorder = true;
+	std::string flightRecorderFile; // dump path, flight_recorder.bin if empty
+	std::string replay;   // flight recorder dump played headlessly, none if empty
+	BenchmarkOptions benchmark;
+};
+
+// Returns false on unknown or incomplete option
+bool parseOptions(int argc, char **argv, Options *options)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		bool hasValue = i + 1 < argc;
+		if (strcmp(argv[i], "--renderer") == 0 && hasValue && parseRendererBackend(argv[i + 1], &options->backend))
+		{
+			i++;
+		}
+		else if (strcmp(argv[i], "--ball") == 0 && hasValue &&
+				 (strcmp(argv[i + 1], "mesh") == 0 || strcmp(argv[i + 1], "impostor") == 0))
+		{
+			options->ballImpostor = strcmp(argv[++i], "impostor") == 0;
+		}
+		else if (strcmp(argv[i], "--lod") == 0)
+		{
+			options->lod = true;
+		}
+		else if (strcmp(argv[i], "--headless") == 0)
+		{
+			options->headless = true;
+		}
+		else if (strcmp(argv[i], "--frames") == 0 && hasValue && atoi(argv[i + 1]) > 0)
+		{
+			options->benchmark.frames = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--csv") == 0 && hasValue)
+		{
+			options->benchmark.csvPath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--scene-cache") == 0)
+		{
+			options->benchmark.sceneCache = true;
+		}
+		else if (strcmp(argv[i], "--perf-counters") == 0)
+		{
+			options->benchmark.perfCounters = true;
+		}
+		else if (strcmp(argv[i], "--simulation-only") == 0)
+		{
+			options->benchmark.simulationOnly = true;
+		}
+		else if (strcmp(argv[i], "--json") == 0 && hasValue)
+		{
+			options->benchmark.jsonPath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--baseline") == 0 && hasValue)
+		{
+			options->benchmark.baselinePath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--tolerance-scale") == 0 && hasValue && atof(argv[i + 1]) >= 0.)
+		{
+			options->benchmark.toleranceScale = atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--governor") == 0)
+		{
+			options->benchmark.governor = true;
+		}
+		else if (strcmp(argv[i], "--governor-log") == 0 && hasValue)
+		{
+			options->benchmark.governor = true;
+			options->benchmark.governorLog = argv[++i];
+		}
+		else if (strcmp(argv[i], "--pacing") == 0 && hasValue && parsePacingMode(argv[i + 1], &options->pacing))
+		{
+			i++;
+		}
+		else if (strcmp(argv[i], "--raw-mouse") == 0)
+		{
+			options->rawMouse = true;
+		}
+		else if (strcmp(argv[i], "--no-latch") == 0)
+		{
+			options->lateLatch = false;
+		}
+		else if (strcmp(argv[i], "--no-idle") == 0)
+		{
+			options->idle = false;
+		}
+		else if (strcmp(argv[i], "--overlay") == 0)
+		{
+			options->overlay = true;
+		}
+		else if (strcmp(argv[i], "--stats-csv") == 0 && hasValue)
+		{
+			options->statsCsv = argv[++i];
+		}
+		else if (strcmp(argv[i], "--stats-interval") == 0 && hasValue && atof(argv[i + 1]) > 0.)
+		{
+			options->statsInterval = atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--rewind-seconds") == 0 && hasValue && atof(argv[i + 1]) >= 0.)
+		{
+			options->rewindSeconds = atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--flight-recorder") == 0 && hasValue)
+		{
+			options->flightRecorderFile = argv[++i];
+		}
+		else if (strcmp(argv[i], "--no-flight-recorder") == 0)
+		{
+			options->flightRecorder = false;
+		}
+		else if (strcmp(argv[i], "--replay") == 0 && hasValue)
+		{
+			options->replay = argv[++i];
+		}
+		else if (strcmp(argv[i], "--log") == 0 && hasValue)
+		{
+			options->log = argv[++i];
+		}
+		else if (strcmp(argv[i], "--trace") == 0 && hasValue)
+		{
+			options->trace = argv[++i];
+		}
+		else if (strcmp(argv[i], "--frame-log") == 0 && hasValue)
+		{
+			options->frameLog = argv[++i];
+		}
+		else if (strcmp(argv[i], "--threads") == 0 && hasValue && atoi(argv[i + 1]) >= 0)
+		{
+			options->threads = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--seed") == 0 && hasValue)
+		{
+			options->hasSeed = true;
+			options->seed = strtoul(argv[++i], NULL, 10);
+		}
+		else
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// Create the renderer selected on the command line
+Renderer *setupRenderer(const Options &options)
+{
+	Renderer *created = createRenderer(options.backend);
+	created->lodEnabled = options.lod;
+	if (options.ballImpostor && !created->enableSphereImpostor())
+	{
+		std::cout << "Sphere impostor not available, the ball stays tessellated" << std::endl;
+	}
+	return created;
+}
+
+// Profiler trace asked on the command line
+void writeTrace(const Options &options)
+{
+	if (!options.trace.empty() && !profilerWriteTrace(options.trace))
+	{
+		std::cout << (profilerEnabled() ? "Cannot write " + options.trace : "Profiler not built (LIGHT_CORRIDOR_PROFILER), no trace") << std::endl;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	Options options;
+	if (!parseOptions(argc, argv, &options))
+	{
+		printUsage(argv[0]);
+		return -1;
+	}
+
+	srand(options.hasSeed ? options.seed : time(NULL));
+	setRecordThreads(options.threads);
+	PROFILE_THREAD("main");
+	if (!options.trace.empty())
+	{
+		traceFile = options.trace;
+	}
+
+	/* Flight recorder dump played again, no window */
+	if (!options.replay.empty())
+	{
+		return replayFlightRecord(options.replay.c_str());
+	}
+
+	/* Headless simulation only: no window, no GL */
+	if (options.headless && (options.backend == RENDERER_NULL || options.benchmark.simulationOnly))
+	{
+		renderer = setupRenderer(options);
+		int result = runHeadlessBenchmark(*renderer, game, options.benchmark);
+		writeTrace(options);
+		printMemoryReport();
+		delete renderer;
+		setRecordThreads(0);
+		return result;
+	}
+
 	/* GLFW initialisation */
 	GLFWwindow *window;
 	if (!glfwInit())
@@ -144,7 +533,12 @@ int main(int /* argc */, char ** /* argv */)
 	/* Callback to a function if an error is rised by GLFW */
 	glfwSetErrorCallback(onError);
 
-	/* Create a windowed mode window and its OpenGL context */
+	/* Create a windowed mode window and its OpenGL context
+	   (invisible in headless mode, GLFW built with GLFW_USE_OSMESA gives an offscreen context) */
+	if (options.headless)
+	{
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	}
 	window = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, WINDOW_TITLE, NULL, NULL);
 	if (!window)
 	{
@@ -162,63 +556,242 @@ int main(int /* argc */, char ** /* argv */)
 		return -1;
 	}
 
-	srand(time(NULL));
+	renderer = setupRenderer(options);
+	std::cout << "Renderer: " << renderer->name() << std::endl;
+
+	glPointSize(5.0);
+	glEnable(GL_DEPTH_TEST);
+
+	// transparency
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glEnable(GL_BLEND);
+
+	if (options.headless)
+	{
+		options.benchmark.width = WINDOW_WIDTH;
+		options.benchmark.height = WINDOW_HEIGHT;
+		int result = runHeadlessBenchmark(*renderer, game, options.benchmark);
+		writeTrace(options);
+		printMemoryReport();
+		delete renderer;
+		setRecordThreads(0);
+		glfwTerminate();
+		return result;
+	}
+
+	if (options.benchmark.sceneCache && renderer->usesGL())
+	{
+		sceneCache = new SceneCache();
+	}
+	if (options.benchmark.governor)
+	{
+		governor = new QualityGovernor(FRAMERATE_IN_SECONDS * 1000.);
+	}
+
+	overlay = new PerfOverlay(FRAMERATE_IN_SECONDS * 1000.);
+	overlay->visible = options.overlay;
+	if (!options.statsCsv.empty() && !overlay->openCsv(options.statsCsv, options.statsInterval))
+	{
+		std::cout << "Cannot write " << options.statsCsv << std::endl;
+	}
 
 	glfwSetWindowSizeCallback(window, onWindowResized);
 	glfwSetKeyCallback(window, onKey);
+	glfwSetWindowRefreshCallback(window, onWindowRefresh);
 	onWindowResized(window, WINDOW_WIDTH, WINDOW_HEIGHT);
 
 	glfwSetMouseButtonCallback(window, mouse_callback); // mouse click
 	glfwSetCursorPosCallback(window, cursor_callback);	// cursor position
+	if (options.rawMouse)
+	{
+		glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+		glfwSetCursorPos(window, WINDOW_WIDTH / 2., WINDOW_HEIGHT / 2.);
+		rawMouse = true;
+		if (glfwRawMouseMotionSupported())
+		{
+			glfwSetInputMode(window, GLFW_RAW_MOUSE_MOTION, GLFW_TRUE);
+		}
+		else
+		{
+			std::cout << "Raw mouse motion not supported, using the disabled cursor motion" << std::endl;
+		}
+	}
 
-	glPointSize(5.0);
-	glEnable(GL_DEPTH_TEST);
+	game.loadGame(); // load the game
 
-	// transparency
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-	glEnable(GL_BLEND);
+	FramePacer pacer(options.pacing, FRAMERATE_IN_SECONDS);
+	pacer.applySwapInterval();
+	if (!options.frameLog.empty() && !pacer.openLog(options.frameLog))
+	{
+		std::cout << "Cannot write " << options.frameLog << std::endl;
+	}
+	if (options.lateLatch)
+	{
+		mainWindow = window;
+		framePacer = &pacer;
+		setRacketLatch(latchRacket);
+	}
 
-	game.loadGame(); // load the game
+	/* Gameplay output goes through the logger thread from now on */
+	if (!startLogger(options.log.empty() ? NULL : options.log.c_str()))
+	{
+		std::cout << "Cannot write " << options.log << ", logging to stdout" << std::endl;
+	}
+
+	/* Always on crash flight recorder */
+	if (options.flightRecorder)
+	{
+		if (!options.flightRecorderFile.empty())
+		{
+			flightRecorderFile = options.flightRecorderFile;
+		}
+		if (!startFlightRecorder(flightRecorderFile.c_str()))
+		{
+			std::cout << "Flight recorder path too long: " << flightRecorderFile << std::endl;
+		}
+	}
+
+	/* Always on rewind history, one delta per simulated tick */
+	RewindBuffer *rewind = NULL;
+	if (options.rewindSeconds > 0.)
+	{
+		rewind = new RewindBuffer(options.rewindSeconds / FRAMERATE_IN_SECONDS);
+		LOG_INFO("REWIND: %.0f s, %d ticks, %zu bytes", options.rewindSeconds, rewind->capacity(), rewind->memoryBytes());
+	}
 
 	/* Loop until the user closes the window */
+	long idleWaits = 0;
+	bool still = false;
 	while (!glfwWindowShouldClose(window))
 	{
-		/* Get time (in second) at loop beginning */
-		double startTime = glfwGetTime();
+		/* Nothing moved and no event since the last image: sleep until an event */
+		if (options.idle && still)
+		{
+			PROFILE_ZONE("wait events");
+			glfwWaitEvents();
+			idleWaits++;
+		}
 
-		/* Cleaning buffers and setting Matrix Mode */
-		glClearColor(0.2, 0.0, 0.0, 0.0);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		pacer.beginFrame();
+		PROFILE_ZONE("frame");
+		long allocationsAtStart = allocationCounters().count;
 
-		/* Scene rendering */
-		if (game.gameState == ONGOING)
+		/* Poll for and process events (right before they are used) */
 		{
-			if (game.ball.isThrown)
+			PROFILE_ZONE("poll");
+			glfwPollEvents();
+		}
+		pacer.inputPolled();
+
+		/* Simulation, or back in time while Backspace is held */
+		FrameState before(game);
+		if (rewind && glfwGetKey(window, GLFW_KEY_BACKSPACE) == GLFW_PRESS)
+		{
+			PROFILE_ZONE("rewind");
+			if (rewind->stepBack(&game))
+			{
+				recordJump();
+			}
+		}
+		else
+		{
+			PROFILE_ZONE("simulation");
+			if (game.gameState == ONGOING)
 			{
-				game.ball.pos.x += game.ball.speed.x;
-				game.ball.pos.y += game.ball.speed.y;
-				game.ball.pos.z += game.ball.speed.z;
+				game.step();
+				if (rewind)
+				{
+					rewind->record(game);
+				}
 			}
-			game.ball.checkCollisions(game.corridor, game.player, game.currentPos);
-			game.playerState();
+			recordTick(game);
 		}
-		draw();
+		pacer.simulated();
 
-		/* Swap front and back buffers */
-		glfwSwapBuffers(window);
+		/* Still scene: the previous image is still on screen */
+		still = !redrawNeeded && FrameState(game) == before;
+		redrawNeeded = false;
+		if (options.idle && still)
+		{
+			continue;
+		}
 
-		/* Poll for and process events */
-		glfwPollEvents();
+		/* Cleaning buffers and setting Matrix Mode */
+		{
+			PROFILE_ZONE("draw");
+			MEMORY_TAG(MEMORY_TAG_RENDERING);
+			glClearColor(0.2, 0.0, 0.0, 0.0);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-		/* Elapsed time computation from loop begining */
-		double elapsedTime = glfwGetTime() - startTime;
-		/* If to few time is spend vs our wanted FPS, we wait */
-		if (elapsedTime < FRAMERATE_IN_SECONDS)
+			/* Scene rendering */
+			if (governor)
+			{
+				governor->beginFrame(*renderer);
+			}
+			renderer->beginFrame();
+			draw();
+			renderer->endFrame();
+			if (governor)
+			{
+				governor->endFrame(*renderer);
+			}
+		}
+
+		/* Counters of the frame, then the overlay which is not part of them */
+		OverlaySample sample;
+		sample.drawCalls = renderer->stats.drawCalls;
+		sample.vertices = renderer->stats.vertices;
+		sample.obstaclesTested = game.ball.obstaclesTested;
+		sample.allocations = allocationCounters().count - allocationsAtStart;
+		{
+			PROFILE_ZONE("overlay");
+			int width, height;
+			glfwGetFramebufferSize(window, &width, &height);
+			overlay->draw(*renderer, width, height);
+		}
+		pacer.drawn();
+
+		/* Swap front and back buffers */
+		{
+			PROFILE_ZONE("swap");
+			glfwSwapBuffers(window);
+		}
+		pacer.swapped();
+
+		/* Wait for the next frame (limiter modes) */
+		{
+			PROFILE_ZONE("pace");
+			pacer.endFrame();
+		}
+		if (governor)
 		{
-			glfwWaitEventsTimeout(FRAMERATE_IN_SECONDS - elapsedTime);
+			governor->frameFinished(pacer.last().work());
 		}
+		sample.frameMs = pacer.last().work();
+		overlay->frameFinished(sample);
+		memoryFrameFinished();
 	}
 
+	setRacketLatch(NULL);
+	stopFlightRecorder();
+	printMemoryReport();
+	stopLogger();
+	if (options.idle)
+	{
+		std::cout << idleWaits << " idle waits for events" << std::endl;
+	}
+	pacer.printSummary();
+	writeTrace(options);
+	if (governor && !options.benchmark.governorLog.empty() && !governor->writeLog(options.benchmark.governorLog))
+	{
+		std::cout << "Cannot write " << options.benchmark.governorLog << std::endl;
+	}
+	delete rewind;
+	delete overlay;
+	delete governor;
+	delete sceneCache;
+	delete renderer;
+	setRecordThreads(0);
 	glfwTerminate();
 	return 0;
 }
\ No newline at end of file
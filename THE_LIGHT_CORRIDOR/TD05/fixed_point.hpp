@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+/* Q16.16 fixed point number: 16 integer bits (positions up to +-32767),
+   a resolution of 1/65536. Arithmetic is integer only (64-bit
+   intermediates for products and quotients, truncated toward zero), so it
+   gives the same bits with any compiler, flags or CPU.
+   Conversions from and to double are both explicit (toDouble() for the
+   rendering and the logs), so mixing a double into the physics does not
+   compile instead of silently computing in floating point. */
+class Fixed
+{
+public:
+    static const std::int32_t ONE = 1 << 16;
+
+    std::int32_t raw;
+
+    Fixed() = default;
+
+    explicit Fixed(int value)
+        : raw{value * ONE}
+    {
+    }
+
+    explicit Fixed(double value)
+        : raw{(std::int32_t)std::lround(value * ONE)}
+    {
+    }
+
+    explicit operator double() const
+    {
+        return raw / (double)ONE;
+    }
+
+    static Fixed fromRaw(std::int32_t raw)
+    {
+        Fixed value;
+        value.raw = raw;
+        return value;
+    }
+
+    Fixed operator-() const { return fromRaw(-raw); }
+    Fixed &operator+=(Fixed other)
+    {
+        raw += other.raw;
+        return *this;
+    }
+    Fixed &operator-=(Fixed other)
+    {
+        raw -= other.raw;
+        return *this;
+    }
+};
+
+inline Fixed operator+(Fixed a, Fixed b) { return Fixed::fromRaw(a.raw + b.raw); }
+inline Fixed operator-(Fixed a, Fixed b) { return Fixed::fromRaw(a.raw - b.raw); }
+inline Fixed operator*(Fixed a, Fixed b) { return Fixed::fromRaw((std::int32_t)((std::int64_t)a.raw * b.raw / Fixed::ONE)); }
+inline Fixed operator/(Fixed a, Fixed b) { return Fixed::fromRaw((std::int32_t)((std::int64_t)a.raw * Fixed::ONE / b.raw)); }
+inline Fixed operator*(Fixed a, int b) { return Fixed::fromRaw(a.raw * b); }
+inline Fixed operator/(Fixed a, int b) { return Fixed::fromRaw(a.raw / b); }
+
+inline bool operator==(Fixed a, Fixed b) { return a.raw == b.raw; }
+inline bool operator!=(Fixed a, Fixed b) { return a.raw != b.raw; }
+inline bool operator<(Fixed a, Fixed b) { return a.raw < b.raw; }
+inline bool operator<=(Fixed a, Fixed b) { return a.raw <= b.raw; }
+inline bool operator>(Fixed a, Fixed b) { return a.raw > b.raw; }
+inline bool operator>=(Fixed a, Fixed b) { return a.raw >= b.raw; }
+
+/* Number type of the simulation (positions, speeds, sizes): fixed point
+   with the CMake option LIGHT_CORRIDOR_FIXED_POINT, double otherwise */
+#ifdef FIXED_POINT_PHYSICS
+typedef Fixed Scalar;
+#else
+typedef double Scalar;
+#endif
+
+// A Scalar as a double, for the rendering and the logs
+inline double toDouble(Fixed value) { return (double)value; }
+inline double toDouble(double value) { return value; }
@@ -0,0 +1,385 @@
+#include "flight_recorder.hpp"
+#include <algorithm>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#define FLIGHT_POSIX
+#endif
+
+static const char MAGIC[8] = "TLCFR01";
+
+/* State of the game after a jump, or every FLIGHT_CHECKPOINT_PERIOD ticks */
+class Checkpoint
+{
+public:
+    std::uint32_t tick;
+    std::uint32_t jump;
+    GameSnapshot snapshot;
+};
+
+/* Start of the dump file; the counters of the rings live here so the
+   signal handler writes it as is */
+class FlightHeader
+{
+public:
+    char magic[8];
+    std::uint32_t ticks;
+    std::uint32_t events;
+    std::uint32_t checkpoints;
+    std::uint32_t snapshotSize; // a dump is only replayed by the same build
+    std::uint64_t nextTick;
+    std::uint64_t eventCount;
+    std::uint64_t checkpointCount;
+};
+
+static FlightHeader header;
+static std::uint64_t hashes[FLIGHT_TICKS];
+static InputEvent events[FLIGHT_EVENTS];
+static Checkpoint checkpoints[FLIGHT_CHECKPOINTS];
+
+static bool recording = false;
+static bool jumpPending = true;
+static char dumpPath[512];
+
+void applyInput(Game &game, const InputEvent &event)
+{
+    switch (event.type)
+    {
+    case INPUT_RACKET:
+        game.player.pos.x = event.x;
+        game.player.pos.z = event.z;
+        // Move ball followed by racket position if not thrown
+        if (!game.ball.isThrown)
+        {
+            game.ball.pos.x = event.x;
+            game.ball.pos.z = event.z;
+        }
+        break;
+
+    case INPUT_THROW:
+        game.ball.isThrown = true;
+        break;
+
+    case INPUT_FORWARD:
+        if (game.ball.isThrown)
+        {
+            game.moveForward(1);
+        }
+        break;
+    }
+}
+
+/* FNV-1a on 64-bit words instead of bytes: one xor and one multiply per field */
+static const std::uint64_t FNV_OFFSET = 14695981039346656037ull;
+static const std::uint64_t FNV_PRIME = 1099511628211ull;
+
+static void mix(std::uint64_t *hash, std::uint64_t word)
+{
+    *hash = (*hash ^ word) * FNV_PRIME;
+}
+
+static void mix(std::uint64_t *hash, double value)
+{
+    // -0 and +0 are the same value (a reflection may give either)
+    std::uint64_t word = 0;
+    if (value != 0)
+    {
+        std::memcpy(&word, &value, sizeof(word));
+    }
+    mix(hash, word);
+}
+
+#ifdef FIXED_POINT_PHYSICS
+static void mix(std::uint64_t *hash, Fixed value)
+{
+    mix(hash, (std::uint64_t)(std::uint32_t)value.raw);
+}
+#endif
+
+static void mix(std::uint64_t *hash, const Vec3s &position)
+{
+    mix(hash, position.x);
+    mix(hash, position.y);
+    mix(hash, position.z);
+}
+
+std::uint64_t hashGame(const Game &game)
+{
+    std::uint64_t hash = FNV_OFFSET;
+    mix(&hash, game.ball.pos);
+    mix(&hash, game.ball.speed);
+    mix(&hash, game.player.pos);
+    mix(&hash, game.currentPos);
+    mix(&hash, (std::uint64_t)game.ball.isThrown | (std::uint64_t)game.player.bonusStick << 1 | (std::uint64_t)game.player.bonusLife << 2 |
+                   (std::uint64_t)game.gameState << 8 | (std::uint64_t)(unsigned int)game.life << 16 | (std::uint64_t)(unsigned int)game.score << 32);
+    mix(&hash, (std::uint64_t)game.corridorSeed | (std::uint64_t)game.corridor.obstacles.size() << 32);
+    for (const Obstacle &obstacle : game.corridor.obstacles)
+    {
+        mix(&hash, obstacle.pos);
+        mix(&hash, (double)obstacle.width);
+    }
+    return hash;
+}
+
+/* Dump, called from the signal handler too */
+
+#ifdef FLIGHT_POSIX
+
+static bool writeAll(int fd, const void *data, size_t size)
+{
+    const char *bytes = static_cast<const char *>(data);
+    while (size > 0)
+    {
+        ssize_t written = write(fd, bytes, size);
+        if (written <= 0)
+        {
+            return false;
+        }
+        bytes += written;
+        size -= written;
+    }
+    return true;
+}
+
+static bool writeDump()
+{
+    int fd = open(dumpPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        return false;
+    }
+    bool written = writeAll(fd, &header, sizeof(header)) && writeAll(fd, hashes, sizeof(hashes)) &&
+                   writeAll(fd, events, sizeof(events)) && writeAll(fd, checkpoints, sizeof(checkpoints));
+    close(fd);
+    return written;
+}
+
+static const int FATAL_SIGNALS[] = {SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT, SIGQUIT};
+
+static void onFatalSignal(int number)
+{
+    static const char MESSAGE[] = "fatal signal, flight recorder dumped\n";
+    if (writeDump())
+    {
+        writeAll(STDERR_FILENO, MESSAGE, sizeof(MESSAGE) - 1);
+    }
+    // The handler was reset: the signal now does what it would have done
+    raise(number);
+}
+
+static void installHandlers(bool install)
+{
+    for (int number : FATAL_SIGNALS)
+    {
+        struct sigaction action;
+        std::memset(&action, 0, sizeof(action));
+        action.sa_handler = install ? onFatalSignal : SIG_DFL;
+        action.sa_flags = install ? SA_RESETHAND : 0;
+        sigemptyset(&action.sa_mask);
+        sigaction(number, &action, NULL);
+    }
+}
+
+#else
+
+static bool writeDump()
+{
+    FILE *file = std::fopen(dumpPath, "wb");
+    if (!file)
+    {
+        return false;
+    }
+    bool written = std::fwrite(&header, sizeof(header), 1, file) == 1 && std::fwrite(hashes, sizeof(hashes), 1, file) == 1 &&
+                   std::fwrite(events, sizeof(events), 1, file) == 1 && std::fwrite(checkpoints, sizeof(checkpoints), 1, file) == 1;
+    std::fclose(file);
+    return written;
+}
+
+// Dumps on F8 only (no async-signal-safe file output here)
+static void installHandlers(bool)
+{
+}
+
+#endif
+
+bool startFlightRecorder(const char *path)
+{
+    if (std::strlen(path) >= sizeof(dumpPath))
+    {
+        return false;
+    }
+    std::strcpy(dumpPath, path);
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.ticks = FLIGHT_TICKS;
+    header.events = FLIGHT_EVENTS;
+    header.checkpoints = FLIGHT_CHECKPOINTS;
+    header.snapshotSize = sizeof(GameSnapshot);
+    jumpPending = true;
+    recording = true;
+    installHandlers(true);
+    return true;
+}
+
+void stopFlightRecorder()
+{
+    if (recording)
+    {
+        installHandlers(false);
+        recording = false;
+    }
+}
+
+void recordInput(INPUT_EVENTS type, Scalar x, Scalar z)
+{
+    if (!recording)
+    {
+        return;
+    }
+    InputEvent &event = events[header.eventCount % FLIGHT_EVENTS];
+    event.tick = header.nextTick;
+    event.type = type;
+    event.x = x;
+    event.z = z;
+    header.eventCount++;
+}
+
+void recordJump()
+{
+    jumpPending = true;
+}
+
+void recordTick(const Game &game)
+{
+    if (!recording)
+    {
+        return;
+    }
+    std::uint64_t tick = header.nextTick;
+    hashes[tick % FLIGHT_TICKS] = hashGame(game);
+    if (jumpPending || tick % FLIGHT_CHECKPOINT_PERIOD == 0)
+    {
+        Checkpoint &checkpoint = checkpoints[header.checkpointCount % FLIGHT_CHECKPOINTS];
+        checkpoint.tick = tick;
+        checkpoint.jump = jumpPending;
+        checkpoint.snapshot = game.snapshot();
+        header.checkpointCount++;
+        jumpPending = false;
+    }
+    header.nextTick++;
+}
+
+bool dumpFlightRecorder()
+{
+    return recording && writeDump();
+}
+
+/* Replay */
+
+static const char *const INPUT_NAMES[] = {"racket", "throw", "forward"};
+
+int replayFlightRecord(const char *path)
+{
+    std::ifstream file(path, std::ios::binary);
+    FlightHeader recorded;
+    if (!file.read(reinterpret_cast<char *>(&recorded), sizeof(recorded)) ||
+        std::memcmp(recorded.magic, MAGIC, sizeof(MAGIC)) != 0)
+    {
+        std::cout << path << ": not a flight recorder dump" << std::endl;
+        return -1;
+    }
+    if (recorded.ticks != (std::uint32_t)FLIGHT_TICKS || recorded.events != (std::uint32_t)FLIGHT_EVENTS ||
+        recorded.checkpoints != (std::uint32_t)FLIGHT_CHECKPOINTS || recorded.snapshotSize != sizeof(GameSnapshot))
+    {
+        std::cout << path << ": recorded by another build" << std::endl;
+        return -1;
+    }
+    // Static: the rings are too large for the stack
+    static std::uint64_t recordedHashes[FLIGHT_TICKS];
+    static InputEvent recordedEvents[FLIGHT_EVENTS];
+    static Checkpoint recordedCheckpoints[FLIGHT_CHECKPOINTS];
+    if (!file.read(reinterpret_cast<char *>(recordedHashes), sizeof(recordedHashes)) ||
+        !file.read(reinterpret_cast<char *>(recordedEvents), sizeof(recordedEvents)) ||
+        !file.read(reinterpret_cast<char *>(recordedCheckpoints), sizeof(recordedCheckpoints)))
+    {
+        std::cout << path << ": truncated dump" << std::endl;
+        return -1;
+    }
+
+    // Oldest tick whose hash and inputs are all held
+    std::uint64_t endTick = recorded.nextTick;
+    std::uint64_t firstTick = endTick > FLIGHT_TICKS ? endTick - FLIGHT_TICKS : 0;
+    std::uint64_t firstEvent = recorded.eventCount > FLIGHT_EVENTS ? recorded.eventCount - FLIGHT_EVENTS : 0;
+    if (firstEvent > 0)
+    {
+        firstTick = std::max<std::uint64_t>(firstTick, recordedEvents[firstEvent % FLIGHT_EVENTS].tick);
+    }
+
+    // The replay starts at the oldest checkpoint after it
+    std::uint64_t firstCheckpoint = recorded.checkpointCount > FLIGHT_CHECKPOINTS ? recorded.checkpointCount - FLIGHT_CHECKPOINTS : 0;
+    std::uint64_t checkpoint = firstCheckpoint;
+    while (checkpoint < recorded.checkpointCount && recordedCheckpoints[checkpoint % FLIGHT_CHECKPOINTS].tick < firstTick)
+    {
+        checkpoint++;
+    }
+    if (checkpoint == recorded.checkpointCount)
+    {
+        std::cout << path << ": no checkpoint in the " << endTick - firstTick << " recorded ticks" << std::endl;
+        return -1;
+    }
+
+    Game game;
+    std::uint64_t startTick = recordedCheckpoints[checkpoint % FLIGHT_CHECKPOINTS].tick;
+    std::uint64_t event = firstEvent;
+    long inputs = 0;
+    for (std::uint64_t tick = startTick; tick < endTick; tick++)
+    {
+        while (event < recorded.eventCount && recordedEvents[event % FLIGHT_EVENTS].tick < tick)
+        {
+            event++;
+        }
+        const Checkpoint *jump = NULL;
+        if (checkpoint < recorded.checkpointCount && recordedCheckpoints[checkpoint % FLIGHT_CHECKPOINTS].tick == tick)
+        {
+            const Checkpoint &held = recordedCheckpoints[checkpoint % FLIGHT_CHECKPOINTS];
+            jump = (held.jump || tick == startTick) ? &held : NULL;
+            checkpoint++;
+        }
+
+        const char *lastInput = "none";
+        if (jump)
+        {
+            game.restore(jump->snapshot);
+        }
+        else
+        {
+            for (; event < recorded.eventCount && recordedEvents[event % FLIGHT_EVENTS].tick == tick; event++)
+            {
+                applyInput(game, recordedEvents[event % FLIGHT_EVENTS]);
+                lastInput = INPUT_NAMES[recordedEvents[event % FLIGHT_EVENTS].type];
+                inputs++;
+            }
+            game.step();
+        }
+
+        std::uint64_t hash = hashGame(game);
+        if (hash != recordedHashes[tick % FLIGHT_TICKS])
+        {
+            char line[160];
+            std::snprintf(line, sizeof(line), "desync at tick %llu (%llu ticks after the start, last input %s): hash %016llx, recorded %016llx",
+                          (unsigned long long)tick, (unsigned long long)(tick - startTick), lastInput,
+                          (unsigned long long)hash, (unsigned long long)recordedHashes[tick % FLIGHT_TICKS]);
+            std::cout << line << std::endl;
+            return 1;
+        }
+    }
+    std::cout << "replayed ticks " << startTick << " to " << endTick - 1 << " with " << inputs
+              << " inputs: every state hash matches (score " << game.score << ", life " << game.life << ")" << std::endl;
+    return 0;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "elements.hpp"
+#include <cstdint>
+
+/* Player inputs, as they change the game (the racket position is the one
+   computed from the cursor, so the replay does not depend on the window) */
+enum INPUT_EVENTS
+{
+    INPUT_RACKET,  // racket (and ball not thrown yet) moved to x, z
+    INPUT_THROW,   // right click
+    INPUT_FORWARD  // left click
+};
+
+class InputEvent
+{
+public:
+    unsigned int tick;
+    INPUT_EVENTS type;
+    Scalar x, z;
+};
+
+// What an input does to the game, shared by the callbacks and the replay
+void applyInput(Game &game, const InputEvent &event);
+
+// 64-bit FNV-1a of everything a tick or an input can change, and the level
+std::uint64_t hashGame(const Game &game);
+
+/* Crash flight recorder, always on: rings allocated once keep the inputs
+   and a state hash of the last FLIGHT_TICKS ticks, with a snapshot of the
+   game every FLIGHT_CHECKPOINT_PERIOD ticks and after every change that is
+   not an input (level loaded, checkpoint restored, rewind). The rings are
+   written raw to the dump file on F8 and from the handler of fatal
+   signals (SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT), with async-signal-
+   safe calls only. --replay plays a dump again headlessly and reports the
+   first tick whose hash differs. */
+static const int FLIGHT_TICKS = 4096;
+static const int FLIGHT_EVENTS = 4 * FLIGHT_TICKS;
+static const int FLIGHT_CHECKPOINTS = 16;
+static const int FLIGHT_CHECKPOINT_PERIOD = 512;
+
+bool startFlightRecorder(const char *path);
+void stopFlightRecorder();
+
+// Inputs are attributed to the tick in progress
+void recordInput(INPUT_EVENTS type, Scalar x = Scalar(0), Scalar z = Scalar(0));
+
+// The game changed outside of the inputs and the simulation
+void recordJump();
+
+// End of a tick (after the simulation step, whatever the game state)
+void recordTick(const Game &game);
+
+// Write the rings to the dump file, returns false if it cannot be written
+bool dumpFlightRecorder();
+
+// Play a dump again: 0 if every hash matches, 1 on desync, -1 if unreadable
+int replayFlightRecord(const char *path);
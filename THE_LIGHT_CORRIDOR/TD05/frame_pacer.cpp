@@ -0,0 +1,213 @@
+#include "frame_pacer.hpp"
+#include "GLFW/glfw3.h"
+#include "benchmark.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+
+static double toMs(FramePacer::Clock::duration duration)
+{
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+FramePacer::FramePacer(PACING_MODES mode, double targetSeconds)
+    : pacing{mode},
+      target{std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(targetSeconds))},
+      limit{mode != PACING_VSYNC}, history(HISTORY)
+{
+    current = FrameRecord();
+    frameStart = mark = deadline = Clock::now();
+}
+
+void FramePacer::applySwapInterval()
+{
+    switch (pacing)
+    {
+    case PACING_VSYNC:
+        glfwSwapInterval(1);
+        break;
+    case PACING_LIMITER:
+        glfwSwapInterval(0);
+        break;
+    case PACING_ADAPTIVE:
+        if (glfwExtensionSupported("WGL_EXT_swap_control_tear") || glfwExtensionSupported("GLX_EXT_swap_control_tear"))
+        {
+            glfwSwapInterval(-1);
+            limit = false;
+        }
+        else
+        {
+            std::cout << "Adaptive vsync not supported, using the frame limiter" << std::endl;
+            glfwSwapInterval(0);
+        }
+        break;
+    }
+}
+
+double FramePacer::lap()
+{
+    Clock::time_point now = Clock::now();
+    double elapsed = toMs(now - mark);
+    mark = now;
+    return elapsed;
+}
+
+void FramePacer::beginFrame()
+{
+    frameStart = mark = polledAt = Clock::now();
+    latched = false;
+}
+
+void FramePacer::inputPolled()
+{
+    polledAt = Clock::now();
+}
+
+void FramePacer::inputLatched()
+{
+    latchedAt = Clock::now();
+    latched = true;
+}
+
+void FramePacer::simulated()
+{
+    current.simulate = lap();
+}
+
+void FramePacer::drawn()
+{
+    current.draw = lap();
+}
+
+void FramePacer::swapped()
+{
+    current.swap = lap();
+    current.polledInputAge = toMs(mark - polledAt);
+    current.latchedInputAge = latched ? toMs(mark - latchedAt) : -1.;
+}
+
+void FramePacer::endFrame()
+{
+    current.idle = 0.;
+    if (limit)
+    {
+        // Fixed cadence: the next deadline follows the previous one, unless
+        // the frame was so late that catching up would mean a burst of frames
+        deadline += target;
+        if (deadline < mark)
+        {
+            deadline = mark;
+        }
+        waitUntil(deadline);
+        current.idle = lap();
+    }
+    current.total = toMs(mark - frameStart);
+    history[ended % HISTORY] = current;
+    if (log)
+    {
+        log << ended << ',' << current.simulate << ',' << current.draw << ',' << current.swap << ','
+            << current.idle << ',' << current.total << ',' << current.polledInputAge << ',' << current.latchedInputAge << '\n';
+    }
+    ended++;
+}
+
+// Sleep by 1 ms steps while the remaining time is larger than the expected
+// oversleep (mean + stddev of the previous sleeps), then spin
+void FramePacer::waitUntil(Clock::time_point time)
+{
+    while (true)
+    {
+        double remaining = toMs(time - Clock::now());
+        double expected = sleepMean + std::sqrt(sleepM2 / sleepCount);
+        if (remaining <= expected)
+        {
+            break;
+        }
+        Clock::time_point before = Clock::now();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        double observed = toMs(Clock::now() - before);
+
+        sleepCount++;
+        double delta = observed - sleepMean;
+        sleepMean += delta / sleepCount;
+        sleepM2 += delta * (observed - sleepMean);
+    }
+    while (Clock::now() < time)
+    {
+        std::this_thread::yield();
+    }
+}
+
+bool FramePacer::openLog(const std::string &path)
+{
+    log.open(path.c_str());
+    if (!log)
+    {
+        return false;
+    }
+    log << "frame,simulate_ms,draw_ms,swap_ms,idle_ms,total_ms,polled_input_age_ms,latched_input_age_ms" << std::endl;
+    return true;
+}
+
+void FramePacer::printSummary() const
+{
+    std::vector<double> simulate, draw, swap, idle, total, polled, latched;
+    long kept = std::min<long>(ended, HISTORY);
+    for (long i = ended - kept; i < ended; i++)
+    {
+        const FrameRecord &frame = history[i % HISTORY];
+        simulate.push_back(frame.simulate);
+        draw.push_back(frame.draw);
+        swap.push_back(frame.swap);
+        idle.push_back(frame.idle);
+        total.push_back(frame.total);
+        polled.push_back(frame.polledInputAge);
+        if (frame.latchedInputAge >= 0.)
+        {
+            latched.push_back(frame.latchedInputAge);
+        }
+    }
+    const char *names[] = {"simulate", "draw", "swap", "idle", "total", "input to present (polled)", "input to present (latched)"};
+    const std::vector<double> *values[] = {&simulate, &draw, &swap, &idle, &total, &polled, &latched};
+    std::cout << ended << " frames paced";
+    if (kept < ended)
+    {
+        std::cout << ", last " << kept << " summarized";
+    }
+    std::cout << std::endl;
+    for (int i = 0; i < 7; i++)
+    {
+        if (values[i]->empty())
+        {
+            continue;
+        }
+        std::cout << std::fixed << std::setprecision(3)
+                  << names[i] << " ms: p50 " << percentile(*values[i], 50)
+                  << "  p95 " << percentile(*values[i], 95)
+                  << "  p99 " << percentile(*values[i], 99) << std::endl;
+    }
+}
+
+bool parsePacingMode(const char *name, PACING_MODES *mode)
+{
+    if (strcmp(name, "vsync") == 0)
+    {
+        *mode = PACING_VSYNC;
+    }
+    else if (strcmp(name, "limiter") == 0)
+    {
+        *mode = PACING_LIMITER;
+    }
+    else if (strcmp(name, "adaptive") == 0)
+    {
+        *mode = PACING_ADAPTIVE;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
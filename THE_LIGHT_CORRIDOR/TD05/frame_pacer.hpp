@@ -0,0 +1,95 @@
+#pragma once
+
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/* Frame pacing modes, selectable with --pacing on the command line */
+enum PACING_MODES
+{
+    PACING_VSYNC,    // swap interval 1: glfwSwapBuffers blocks until the vertical blank
+    PACING_LIMITER,  // swap interval 0, sleep then spin until the frame deadline
+    PACING_ADAPTIVE  // adaptive vsync (late frames tear instead of waiting a whole
+                     // refresh) when the driver has it, the limiter otherwise
+};
+
+/* Durations of one frame, in milliseconds */
+class FrameRecord
+{
+public:
+    double simulate;
+    double draw;
+    double swap; // time blocked in glfwSwapBuffers
+    double idle; // time spent waiting for the deadline
+    double total;
+    // Age at present (glfwSwapBuffers returned) of the input used for the
+    // racket, as polled at the start of the frame and as late latched
+    // before drawing it (negative when there was no latch)
+    double polledInputAge;
+    double latchedInputAge;
+
+    double work() const { return simulate + draw + swap; }
+};
+
+/* Paces the main loop on a std::chrono::steady_clock and records where the
+   time of every frame goes. Call order each frame:
+   beginFrame, simulated, drawn, swapped, endFrame, with inputPolled and
+   inputLatched when the input is read.
+   The records of the last HISTORY frames are kept in a ring allocated
+   once, for the summary; the frame log gets every frame as it ends. */
+class FramePacer
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+    static const int HISTORY = 3600; // a minute at 60 Hz
+
+    FramePacer(PACING_MODES mode, double targetSeconds);
+
+    // Set the swap interval for the mode, the GL context must be current
+    void applySwapInterval();
+    PACING_MODES mode() const { return pacing; }
+
+    void beginFrame();
+    void inputPolled();
+    void inputLatched();
+    void simulated();
+    void drawn();
+    void swapped();
+    // Wait for the frame deadline (limiter) and store the frame record
+    void endFrame();
+
+    // Record of the last ended frame
+    const FrameRecord &last() const { return history[(ended + HISTORY - 1) % HISTORY]; }
+    // Write a CSV row per frame from now on, returns false if the file cannot be written
+    bool openLog(const std::string &path);
+    // Percentiles over the last HISTORY frames
+    void printSummary() const;
+
+private:
+    PACING_MODES pacing;
+    Clock::duration target;
+    bool limit; // sleep until the deadline at endFrame()
+
+    Clock::time_point frameStart;
+    Clock::time_point mark;
+    Clock::time_point deadline;
+    Clock::time_point polledAt;
+    Clock::time_point latchedAt;
+    bool latched = false;
+    FrameRecord current;
+    std::vector<FrameRecord> history;
+    long ended = 0; // frames stored by endFrame()
+    std::ofstream log;
+
+    // Oversleep of a 1 ms sleep_for, running mean and variance (Welford)
+    double sleepMean = 1.;
+    double sleepM2 = 0.;
+    long sleepCount = 1;
+
+    double lap(); // ms since the previous mark
+    void waitUntil(Clock::time_point time);
+};
+
+// Parse a --pacing value ("vsync", "limiter" or "adaptive")
+bool parsePacingMode(const char *name, PACING_MODES *mode);
@@ -0,0 +1,70 @@
+#include "glad/glad.h"
+#include "framebuffer.hpp"
+#include <iostream>
+
+static GLuint createTexture(GLint internalFormat, GLenum format, GLenum type, int width, int height)
+{
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return texture;
+}
+
+bool Framebuffer::create(int _width, int _height)
+{
+    release();
+    width = _width;
+    height = _height;
+
+    colorTexture = createTexture(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, width, height);
+    depthTexture = createTexture(GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, width, height);
+
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorTexture, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthTexture, 0);
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cout << "Framebuffer incomplete (0x" << std::hex << status << std::dec << ")" << std::endl;
+        release();
+        return false;
+    }
+    return true;
+}
+
+void Framebuffer::release()
+{
+    if (fbo)
+    {
+        glDeleteFramebuffers(1, &fbo);
+    }
+    if (colorTexture)
+    {
+        glDeleteTextures(1, &colorTexture);
+    }
+    if (depthTexture)
+    {
+        glDeleteTextures(1, &depthTexture);
+    }
+    fbo = colorTexture = depthTexture = 0;
+}
+
+void Framebuffer::bind() const
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glViewport(0, 0, width, height);
+}
+
+void Framebuffer::bindDefault()
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
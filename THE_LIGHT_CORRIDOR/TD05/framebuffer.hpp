@@ -0,0 +1,26 @@
+#pragma once
+
+/* Offscreen render target: RGBA8 color texture + 24 bits depth texture.
+   GL handles are exposed as unsigned int so this header does not need glad. */
+class Framebuffer
+{
+public:
+    unsigned int fbo = 0;
+    unsigned int colorTexture = 0;
+    unsigned int depthTexture = 0;
+    int width = 0;
+    int height = 0;
+
+    Framebuffer() = default;
+    Framebuffer(const Framebuffer &) = delete;
+    Framebuffer &operator=(const Framebuffer &) = delete;
+    ~Framebuffer() { release(); }
+
+    // (Re)allocate the attachments, returns false if the FBO is incomplete
+    bool create(int _width, int _height);
+    void release();
+
+    bool isValid() const { return fbo != 0; }
+    void bind() const;
+    static void bindDefault();
+};
@@ -0,0 +1,252 @@
+#include "glad/glad.h"
+#include "governor.hpp"
+#include "draw_scene.hpp"
+#include "shader.hpp"
+#include "logger.hpp"
+#include <algorithm>
+#include <fstream>
+
+/* Cheapest knobs first: tessellation, then resolution and distance.
+   Level 0 is the scene as drawn without the governor. */
+static const QualityLevel LEVELS[] = {
+    {1.f, 0.f, 0},
+    {1.f, 12.f, 0},
+    {0.75f, 12.f, 6},
+    {0.5f, 24.f, 4},
+};
+static const int NB_LEVELS = sizeof(LEVELS) / sizeof(LEVELS[0]);
+
+static const double OVER_BUDGET = 1.05;
+static const double UNDER_BUDGET = 0.7;
+
+// Upscale: full screen triangle strip sampling the scaled color texture
+static const char *UPSCALE_VERTEX_SHADER =
+    "#version 120\n"
+    "attribute vec2 aPosition;\n"
+    "varying vec2 vUv;\n"
+    "void main()\n"
+    "{\n"
+    "    vUv = aPosition * 0.5 + 0.5;\n"
+    "    gl_Position = vec4(aPosition, 0.0, 1.0);\n"
+    "}\n";
+
+static const char *UPSCALE_FRAGMENT_SHADER =
+    "#version 120\n"
+    "uniform sampler2D uColor;\n"
+    "varying vec2 vUv;\n"
+    "void main()\n"
+    "{\n"
+    "    gl_FragColor = texture2D(uColor, vUv);\n"
+    "}\n";
+
+QualityGovernor::QualityGovernor(double budgetMs)
+    : budget{budgetMs}, lowest{NB_LEVELS - 1}
+{
+    viewport[0] = viewport[1] = viewport[2] = viewport[3] = 0;
+}
+
+QualityGovernor::~QualityGovernor()
+{
+    if (program)
+    {
+        glDeleteBuffers(1, &vbo);
+        glDeleteVertexArrays(1, &vao);
+        glDeleteProgram(program);
+    }
+}
+
+bool QualityGovernor::createUpscale()
+{
+    const char *attribs[] = {"aPosition", NULL};
+    program = createProgram(UPSCALE_VERTEX_SHADER, UPSCALE_FRAGMENT_SHADER, attribs);
+    if (!program)
+    {
+        return false;
+    }
+    glUseProgram(program);
+    glUniform1i(glGetUniformLocation(program, "uColor"), 0);
+    glUseProgram(0);
+
+    const float quad[] = {-1.f, -1.f, 1.f, -1.f, -1.f, 1.f, 1.f, 1.f};
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &vbo);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, (void *)0);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return true;
+}
+
+const QualityLevel &QualityGovernor::settings() const
+{
+    return LEVELS[current];
+}
+
+void QualityGovernor::beginFrame(Renderer &renderer)
+{
+    const QualityLevel &level = LEVELS[current];
+
+    if (!rendererSaved)
+    {
+        baseLodEnabled = renderer.lodEnabled;
+        baseLodPixels = renderer.lodSegmentPixels;
+        rendererSaved = true;
+    }
+    renderer.lodEnabled = level.lodSegmentPixels > 0.f || baseLodEnabled;
+    renderer.lodSegmentPixels = level.lodSegmentPixels > 0.f ? level.lodSegmentPixels : baseLodPixels;
+    setDrawDistance(level.drawSections);
+
+    scaling = false;
+    if (!renderer.usesGL())
+    {
+        return;
+    }
+    if (level.renderScale >= 1.f || (!program && !createUpscale()))
+    {
+        return;
+    }
+
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &target);
+    int width = std::max(1, (int)(viewport[2] * level.renderScale));
+    int height = std::max(1, (int)(viewport[3] * level.renderScale));
+    if (scaled.width != width || scaled.height != height || !scaled.isValid())
+    {
+        if (!scaled.create(width, height))
+        {
+            glBindFramebuffer(GL_FRAMEBUFFER, target);
+            return; // full resolution then
+        }
+        glBindTexture(GL_TEXTURE_2D, scaled.colorTexture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    renderer.flush();
+    scaled.bind();
+    renderer.setViewport(width, height);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    scaling = true;
+}
+
+void QualityGovernor::endFrame(Renderer &renderer)
+{
+    if (!scaling)
+    {
+        return;
+    }
+
+    renderer.flush();
+    glBindFramebuffer(GL_FRAMEBUFFER, target);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+
+    // The upscaled image replaces the whole target
+    GLboolean blend = glIsEnabled(GL_BLEND);
+    GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+    glDisable(GL_BLEND);
+    glDisable(GL_DEPTH_TEST);
+    glUseProgram(program);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, scaled.colorTexture);
+    glBindVertexArray(vao);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glUseProgram(0);
+    if (blend)
+    {
+        glEnable(GL_BLEND);
+    }
+    if (depthTest)
+    {
+        glEnable(GL_DEPTH_TEST);
+    }
+    renderer.stats.drawCalls++;
+    renderer.stats.vertices += 4;
+
+    renderer.setViewport(viewport[2], viewport[3]);
+    scaling = false;
+}
+
+void QualityGovernor::frameFinished(double frameMs)
+{
+    frame++;
+    samples.push_back(frameMs);
+    if ((int)samples.size() < WINDOW)
+    {
+        return;
+    }
+
+    double average = 0.;
+    for (size_t i = 0; i < samples.size(); i++)
+    {
+        average += samples[i] / samples.size();
+    }
+    samples.clear();
+
+    // First window after a drop: keep it only if it helped
+    double droppedFrom = droppedFromMs;
+    droppedFromMs = 0.;
+    if (droppedFrom > 0. && average > droppedFrom * OVER_BUDGET)
+    {
+        windowsUnderBudget = 0;
+        lowest = current - 1;
+        change(current - 1, average, "slower than before: reverted");
+        return;
+    }
+
+    if (average > budget * OVER_BUDGET)
+    {
+        windowsUnderBudget = 0;
+        if (current < lowest)
+        {
+            droppedFromMs = average;
+            change(current + 1, average, "over budget");
+        }
+    }
+    else if (average < budget * UNDER_BUDGET)
+    {
+        if (++windowsUnderBudget >= WINDOWS_BEFORE_RAISE && current > 0)
+        {
+            windowsUnderBudget = 0;
+            change(current - 1, average, "under budget");
+        }
+    }
+    else
+    {
+        windowsUnderBudget = 0;
+    }
+}
+
+void QualityGovernor::change(int to, double averageMs, const char *reason)
+{
+    GovernorDecision decision = {frame, averageMs, budget, current, to, reason};
+    log.push_back(decision);
+
+    const QualityLevel &level = LEVELS[to];
+    LOG_INFO("governor: frame %ld, %g ms for a %g ms budget (%s), level %d -> %d (scale %g, lod %g px, sections %d)",
+             frame, averageMs, budget, reason, current, to, level.renderScale, level.lodSegmentPixels, level.drawSections);
+    current = to;
+}
+
+bool QualityGovernor::writeLog(const std::string &path) const
+{
+    std::ofstream csv(path.c_str());
+    if (!csv)
+    {
+        return false;
+    }
+    csv << "frame,average_ms,budget_ms,reason,from,to,render_scale,lod_pixels,draw_sections" << std::endl;
+    for (size_t i = 0; i < log.size(); i++)
+    {
+        const GovernorDecision &decision = log[i];
+        const QualityLevel &level = LEVELS[decision.to];
+        csv << decision.frame << ',' << decision.averageMs << ',' << decision.budgetMs << ',' << decision.reason << ','
+            << decision.from << ',' << decision.to << ',' << level.renderScale << ','
+            << level.lodSegmentPixels << ',' << level.drawSections << '\n';
+    }
+    return true;
+}
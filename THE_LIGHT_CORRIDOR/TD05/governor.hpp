@@ -0,0 +1,89 @@
+#pragma once
+
+#include "framebuffer.hpp"
+#include "renderer.hpp"
+#include <string>
+#include <vector>
+
+/* One step of the quality ladder */
+class QualityLevel
+{
+public:
+    float renderScale;      // fraction of the window resolution, upscaled at the end of the frame
+    float lodSegmentPixels; // tessellation (forces the level of detail), 0: renderer settings
+    int drawSections;       // corridor sections drawn ahead of the player, 0: all
+};
+
+/* A level change and what caused it */
+class GovernorDecision
+{
+public:
+    long frame;
+    double averageMs; // over the last window
+    double budgetMs;
+    int from;
+    int to;
+    const char *reason;
+};
+
+/* Holds the frame time under budget by walking a quality ladder.
+   Frame times are averaged over WINDOW frames; a window over budget
+   (+5%) drops one level, several consecutive windows well under budget
+   (-30%) raise one level. Samples are discarded after each change so the
+   new level is measured on its own. A drop that makes frames slower (the
+   upscale pass can cost more than it saves on software GL) is reverted
+   and the levels below are not tried again. Every change is printed and
+   kept. */
+class QualityGovernor
+{
+public:
+    static const int WINDOW = 30;
+    static const int WINDOWS_BEFORE_RAISE = 3;
+
+    explicit QualityGovernor(double budgetMs);
+    ~QualityGovernor();
+
+    QualityGovernor(const QualityGovernor &) = delete;
+    QualityGovernor &operator=(const QualityGovernor &) = delete;
+
+    // Bind the scaled target (if any) and apply the knobs of the current level
+    void beginFrame(Renderer &renderer);
+    // Upscale into the framebuffer bound at beginFrame()
+    void endFrame(Renderer &renderer);
+    // Frame time without the pacing wait, may change the level
+    void frameFinished(double frameMs);
+
+    int level() const { return current; }
+    const QualityLevel &settings() const;
+    const std::vector<GovernorDecision> &decisions() const { return log; }
+    // CSV of the decisions, returns false if the file cannot be written
+    bool writeLog(const std::string &path) const;
+
+private:
+    double budget;
+    int current = 0;
+    int lowest;               // cheapest level still worth trying
+    double droppedFromMs = 0; // average that caused the last drop, 0 once judged
+    long frame = 0;
+    std::vector<double> samples;
+    int windowsUnderBudget = 0;
+    std::vector<GovernorDecision> log;
+
+    // Renderer settings to restore at the levels which keep them
+    bool rendererSaved = false;
+    bool baseLodEnabled = false;
+    float baseLodPixels = 0.f;
+
+    Framebuffer scaled;
+    int target = 0; // framebuffer bound at beginFrame()
+    int viewport[4];
+    bool scaling = false;
+
+    // Bilinear upscale pass, built with the first scaled frame
+    unsigned int program = 0;
+    unsigned int vao = 0;
+    unsigned int vbo = 0;
+
+    bool createUpscale();
+    void change(int to, double averageMs, const char *reason);
+};
@@ -0,0 +1,98 @@
+#include "glad/glad.h"
+#include "impostor.hpp"
+#include "shader.hpp"
+#include <cmath>
+
+static const char *IMPOSTOR_VERTEX_SHADER =
+    "#version 120\n"
+    "uniform vec3 uCenter;\n" // view space
+    "uniform float uRadius;\n"
+    "uniform mat4 uProjection;\n"
+    "attribute vec2 aCorner;\n"
+    "varying vec3 vViewPosition;\n"
+    "void main()\n"
+    "{\n"
+    "    float dist = length(uCenter);\n"
+    "    vec3 axis = uCenter / dist;\n"
+    "    vec3 up = abs(axis.y) < 0.99 ? vec3(0.0, 1.0, 0.0) : vec3(1.0, 0.0, 0.0);\n"
+    "    vec3 right = normalize(cross(axis, up));\n"
+    "    up = cross(right, axis);\n"
+    // radius of the tangent cone in the plane of the center
+    "    float size = uRadius * dist / sqrt(max(dist * dist - uRadius * uRadius, 1e-6));\n"
+    "    vViewPosition = uCenter + (right * aCorner.x + up * aCorner.y) * size;\n"
+    "    gl_Position = uProjection * vec4(vViewPosition, 1.0);\n"
+    "}\n";
+
+static const char *IMPOSTOR_FRAGMENT_SHADER =
+    "#version 120\n"
+    "uniform vec3 uCenter;\n"
+    "uniform float uRadius;\n"
+    "uniform mat4 uProjection;\n"
+    "uniform vec4 uColor;\n"
+    "varying vec3 vViewPosition;\n"
+    "void main()\n"
+    "{\n"
+    "    vec3 ray = normalize(vViewPosition);\n"
+    "    float b = dot(ray, uCenter);\n"
+    "    float delta = b * b - dot(uCenter, uCenter) + uRadius * uRadius;\n"
+    "    if (delta < 0.0)\n"
+    "        discard;\n"
+    "    vec3 hit = ray * (b - sqrt(delta));\n"
+    "    vec4 clip = uProjection * vec4(hit, 1.0);\n"
+    "    float ndcDepth = clip.z / clip.w;\n"
+    "    gl_FragDepth = 0.5 * (gl_DepthRange.diff * ndcDepth + gl_DepthRange.near + gl_DepthRange.far);\n"
+    "    gl_FragColor = uColor;\n"
+    "}\n";
+
+SphereImpostor::SphereImpostor()
+    : program{0}, centerLocation{-1}, radiusLocation{-1}, projectionLocation{-1}, colorLocation{-1}, vao{0}, vbo{0}
+{
+    const char *attribs[] = {"aCorner", NULL};
+    program = createProgram(IMPOSTOR_VERTEX_SHADER, IMPOSTOR_FRAGMENT_SHADER, attribs);
+    if (!program)
+    {
+        return;
+    }
+    centerLocation = glGetUniformLocation(program, "uCenter");
+    radiusLocation = glGetUniformLocation(program, "uRadius");
+    projectionLocation = glGetUniformLocation(program, "uProjection");
+    colorLocation = glGetUniformLocation(program, "uColor");
+
+    const float corners[] = {-1.f, -1.f, 1.f, -1.f, -1.f, 1.f, 1.f, 1.f};
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &vbo);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, (void *)0);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+SphereImpostor::~SphereImpostor()
+{
+    glDeleteBuffers(1, &vbo);
+    glDeleteVertexArrays(1, &vao);
+    glDeleteProgram(program);
+}
+
+void SphereImpostor::draw(const float modelView[16], const float projection[16], const float color[4])
+{
+    float radius = sqrtf(modelView[0] * modelView[0] + modelView[1] * modelView[1] + modelView[2] * modelView[2]);
+    float distance = sqrtf(modelView[12] * modelView[12] + modelView[13] * modelView[13] + modelView[14] * modelView[14]);
+    if (distance <= radius)
+    {
+        return; // camera inside the sphere
+    }
+
+    glUseProgram(program);
+    glUniform3f(centerLocation, modelView[12], modelView[13], modelView[14]);
+    glUniform1f(radiusLocation, radius);
+    glUniformMatrix4fv(projectionLocation, 1, GL_FALSE, projection);
+    glUniform4fv(colorLocation, 1, color);
+    glBindVertexArray(vao);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, VERTICES);
+    glBindVertexArray(0);
+    glUseProgram(0);
+}
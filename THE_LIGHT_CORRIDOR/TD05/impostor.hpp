@@ -0,0 +1,30 @@
+#pragma once
+
+/* Sphere drawn as one camera facing quad, ray-cast per fragment.
+   The quad lies in the plane through the sphere center perpendicular to the
+   view ray, sized to the tangent cone, so it always covers the silhouette.
+   Fragments write the depth of the ray / sphere intersection. */
+class SphereImpostor
+{
+public:
+    static const int VERTICES = 4;
+
+    SphereImpostor();
+    ~SphereImpostor();
+    SphereImpostor(const SphereImpostor &) = delete;
+    SphereImpostor &operator=(const SphereImpostor &) = delete;
+
+    bool isValid() const { return program != 0; }
+
+    // Draw the unit sphere transformed by modelView (uniform scale only)
+    void draw(const float modelView[16], const float projection[16], const float color[4]);
+
+private:
+    unsigned int program;
+    int centerLocation;
+    int radiusLocation;
+    int projectionLocation;
+    int colorLocation;
+    unsigned int vao;
+    unsigned int vbo;
+};
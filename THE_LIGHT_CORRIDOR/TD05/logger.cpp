@@ -0,0 +1,214 @@
+#include "logger.hpp"
+#include "memory_tracker.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+/* Lines held between two writes, a power of two */
+static const unsigned long RING_SIZE = 1024;
+
+/* Time between two batches of the writer thread */
+static const std::chrono::milliseconds WRITE_PERIOD(5);
+
+/* Bounded multi-producer queue (Vyukov): a slot is free for the producer
+   whose position equals its sequence, and readable once the producer has
+   set it to position + 1. The writer gives it back with position +
+   RING_SIZE. */
+class LogSlot
+{
+public:
+    std::atomic<unsigned long> sequence;
+    LOG_LEVELS level;
+    char text[LOG_LINE_SIZE];
+};
+
+class LogRing
+{
+public:
+    LogSlot slots[RING_SIZE];
+    std::atomic<unsigned long> enqueuePosition;
+    unsigned long dequeuePosition; // writer thread only
+    std::atomic<long> dropped;
+
+    LogRing()
+        : enqueuePosition{0}, dequeuePosition{0}, dropped{0}
+    {
+        for (unsigned long i = 0; i < RING_SIZE; i++)
+        {
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+};
+
+static LogRing ring;
+
+static std::thread writer;
+static std::atomic<bool> running{false};
+static FILE *output = NULL;
+
+// Batch of formatted lines, written with a single fwrite
+static char batch[64 * 1024];
+static size_t batchSize = 0;
+
+static const char *levelPrefix(LOG_LEVELS level)
+{
+    switch (level)
+    {
+    case LOG_LEVEL_DEBUG:
+        return "DEBUG: ";
+    case LOG_LEVEL_WARNING:
+        return "WARNING: ";
+    case LOG_LEVEL_ERROR:
+        return "ERROR: ";
+    default:
+        return "";
+    }
+}
+
+static void flushBatch()
+{
+    if (batchSize > 0)
+    {
+        std::fwrite(batch, 1, batchSize, output);
+        std::fflush(output);
+        batchSize = 0;
+    }
+}
+
+static void appendLine(const char *prefix, const char *text)
+{
+    size_t prefixLength = std::strlen(prefix);
+    size_t textLength = std::strlen(text);
+    if (batchSize + prefixLength + textLength + 1 > sizeof(batch))
+    {
+        flushBatch();
+    }
+    std::memcpy(batch + batchSize, prefix, prefixLength);
+    std::memcpy(batch + batchSize + prefixLength, text, textLength);
+    batchSize += prefixLength + textLength;
+    batch[batchSize++] = '\n';
+}
+
+// Move the pending lines to the batch and write it
+static void drain()
+{
+    static long reportedDrops = 0;
+    while (true)
+    {
+        LogSlot &slot = ring.slots[ring.dequeuePosition & (RING_SIZE - 1)];
+        if (slot.sequence.load(std::memory_order_acquire) != ring.dequeuePosition + 1)
+        {
+            break;
+        }
+        appendLine(levelPrefix(slot.level), slot.text);
+        slot.sequence.store(ring.dequeuePosition + RING_SIZE, std::memory_order_release);
+        ring.dequeuePosition++;
+    }
+    long drops = ring.dropped.load(std::memory_order_relaxed);
+    if (drops != reportedDrops)
+    {
+        char text[64];
+        std::snprintf(text, sizeof(text), "%ld log messages dropped (ring full)", drops - reportedDrops);
+        appendLine(levelPrefix(LOG_LEVEL_WARNING), text);
+        reportedDrops = drops;
+    }
+    flushBatch();
+}
+
+static void writerLoop()
+{
+    while (running.load())
+    {
+        drain();
+        std::this_thread::sleep_for(WRITE_PERIOD);
+    }
+    drain();
+}
+
+bool startLogger(const char *path)
+{
+    if (running.load())
+    {
+        return true;
+    }
+    output = path ? std::fopen(path, "w") : NULL;
+    bool opened = output || !path;
+    if (!output)
+    {
+        output = stdout;
+    }
+    MEMORY_TAG(MEMORY_TAG_LOGGING);
+    running.store(true);
+    writer = std::thread(writerLoop);
+    return opened;
+}
+
+void stopLogger()
+{
+    if (!running.load())
+    {
+        return;
+    }
+    running.store(false);
+    writer.join();
+    if (output != stdout)
+    {
+        std::fclose(output);
+    }
+    output = NULL;
+}
+
+void logWrite(LOG_LEVELS level, const char *format, ...)
+{
+    va_list arguments;
+    va_start(arguments, format);
+
+    // No writer thread (tools, before startLogger()): plain synchronous output
+    if (!running.load(std::memory_order_relaxed))
+    {
+        char text[LOG_LINE_SIZE];
+        std::vsnprintf(text, sizeof(text), format, arguments);
+        va_end(arguments);
+        std::printf("%s%s\n", levelPrefix(level), text);
+        return;
+    }
+
+    unsigned long position = ring.enqueuePosition.load(std::memory_order_relaxed);
+    LogSlot *slot;
+    while (true)
+    {
+        slot = &ring.slots[position & (RING_SIZE - 1)];
+        long difference = (long)(slot->sequence.load(std::memory_order_acquire) - position);
+        if (difference == 0)
+        {
+            if (ring.enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (difference < 0)
+        {
+            // Full: the writer is behind, never wait for it
+            ring.dropped.fetch_add(1, std::memory_order_relaxed);
+            va_end(arguments);
+            return;
+        }
+        else
+        {
+            position = ring.enqueuePosition.load(std::memory_order_relaxed);
+        }
+    }
+
+    slot->level = level;
+    std::vsnprintf(slot->text, sizeof(slot->text), format, arguments);
+    va_end(arguments);
+    slot->sequence.store(position + 1, std::memory_order_release);
+}
+
+long logDropped()
+{
+    return ring.dropped.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+/* Asynchronous logger for the game loop.
+   LOG_INFO("CURRENT SCORE: %d", score) formats (printf style) into a slot
+   of a preallocated lock-free ring and returns; a background thread
+   writes the pending lines in batches to stdout or a file. A full ring
+   drops the message (counted, and reported in the output) instead of
+   waiting, so logging never blocks a frame.
+   Levels under LOG_MIN_LEVEL (compile time, INFO by default) compile to
+   nothing. Lines longer than LOG_LINE_SIZE are truncated. */
+
+enum LOG_LEVELS
+{
+    LOG_LEVEL_DEBUG,
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_WARNING,
+    LOG_LEVEL_ERROR
+};
+
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL LOG_LEVEL_INFO
+#endif
+
+static const int LOG_LINE_SIZE = 248;
+
+#define LOG_AT(level, ...)                  \
+    do                                      \
+    {                                       \
+        if ((level) >= LOG_MIN_LEVEL)       \
+        {                                   \
+            logWrite((level), __VA_ARGS__); \
+        }                                   \
+    } while (0)
+
+#define LOG_DEBUG(...) LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define LOG_INFO(...) LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_WARNING(...) LOG_AT(LOG_LEVEL_WARNING, __VA_ARGS__)
+#define LOG_ERROR(...) LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+
+#ifdef __GNUC__
+#define LOG_PRINTF_FORMAT __attribute__((format(printf, 2, 3)))
+#else
+#define LOG_PRINTF_FORMAT
+#endif
+
+// Start the writer thread, to the file at path (NULL: stdout).
+// Returns false if the file cannot be opened (stdout is used then).
+bool startLogger(const char *path);
+// Write what is pending and stop the writer thread
+void stopLogger();
+
+// Use the LOG_* macros rather than calling this directly
+void logWrite(LOG_LEVELS level, const char *format, ...) LOG_PRINTF_FORMAT;
+
+// Messages lost because the ring was full
+long logDropped();
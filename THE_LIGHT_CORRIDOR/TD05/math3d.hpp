@@ -0,0 +1,336 @@
+#pragma once
+
+#include <cmath>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define MATH3D_SSE 1
+#endif
+
+// Vector operators are inlined even without optimizations (debug builds
+// run the simulation through them)
+#if defined(__GNUC__)
+#define MATH3D_INLINE inline __attribute__((always_inline))
+#else
+#define MATH3D_INLINE inline
+#endif
+
+/* 3 component vector of any number type (float, double, or the fixed
+   point Scalar of the simulation): positions and speeds alike */
+template <class T>
+class Vec3
+{
+public:
+    T x, y, z;
+
+    Vec3() = default;
+
+    MATH3D_INLINE Vec3(T _x, T _y, T _z)
+        : x{_x}, y{_y}, z{_z}
+    {
+    }
+
+    static MATH3D_INLINE Vec3 unitX() { return Vec3(T(1), T(0), T(0)); }
+    static MATH3D_INLINE Vec3 unitY() { return Vec3(T(0), T(1), T(0)); }
+    static MATH3D_INLINE Vec3 unitZ() { return Vec3(T(0), T(0), T(1)); }
+
+    MATH3D_INLINE Vec3 operator+(const Vec3 &other) const { return Vec3(x + other.x, y + other.y, z + other.z); }
+    MATH3D_INLINE Vec3 operator-(const Vec3 &other) const { return Vec3(x - other.x, y - other.y, z - other.z); }
+    MATH3D_INLINE Vec3 operator-() const { return Vec3(-x, -y, -z); }
+    MATH3D_INLINE Vec3 operator*(T factor) const { return Vec3(x * factor, y * factor, z * factor); }
+
+    MATH3D_INLINE Vec3 &operator+=(const Vec3 &other)
+    {
+        x += other.x;
+        y += other.y;
+        z += other.z;
+        return *this;
+    }
+
+    MATH3D_INLINE Vec3 &operator-=(const Vec3 &other)
+    {
+        x -= other.x;
+        y -= other.y;
+        z -= other.z;
+        return *this;
+    }
+
+    MATH3D_INLINE bool operator==(const Vec3 &other) const { return x == other.x && y == other.y && z == other.z; }
+    MATH3D_INLINE bool operator!=(const Vec3 &other) const { return !(*this == other); }
+};
+
+typedef Vec3<float> Vec3f;
+typedef Vec3<double> Vec3d;
+
+template <class T>
+MATH3D_INLINE T dot(const Vec3<T> &a, const Vec3<T> &b)
+{
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+// Per component minimum / maximum
+template <class T>
+MATH3D_INLINE Vec3<T> min(const Vec3<T> &a, const Vec3<T> &b)
+{
+    return Vec3<T>(b.x < a.x ? b.x : a.x, b.y < a.y ? b.y : a.y, b.z < a.z ? b.z : a.z);
+}
+
+template <class T>
+MATH3D_INLINE Vec3<T> max(const Vec3<T> &a, const Vec3<T> &b)
+{
+    return Vec3<T>(a.x < b.x ? b.x : a.x, a.y < b.y ? b.y : a.y, a.z < b.z ? b.z : a.z);
+}
+
+// v bounced on a surface of unit normal n (exact for the axes)
+template <class T>
+MATH3D_INLINE Vec3<T> reflect(const Vec3<T> &v, const Vec3<T> &n)
+{
+    return v - n * (dot(v, n) * 2);
+}
+
+/* 4 float vector in one SSE register (16-byte aligned), for points and
+   directions going through a Mat4 (w = 1 for points, 0 for directions) */
+class Vec4
+{
+public:
+    alignas(16) float v[4];
+
+    Vec4() = default;
+
+    MATH3D_INLINE Vec4(float x, float y, float z, float w)
+    {
+#ifdef MATH3D_SSE
+        _mm_store_ps(v, _mm_setr_ps(x, y, z, w));
+#else
+        v[0] = x;
+        v[1] = y;
+        v[2] = z;
+        v[3] = w;
+#endif
+    }
+
+    MATH3D_INLINE float x() const { return v[0]; }
+    MATH3D_INLINE float y() const { return v[1]; }
+    MATH3D_INLINE float z() const { return v[2]; }
+    MATH3D_INLINE float w() const { return v[3]; }
+
+#ifdef MATH3D_SSE
+    MATH3D_INLINE explicit Vec4(__m128 value) { _mm_store_ps(v, value); }
+    MATH3D_INLINE __m128 simd() const { return _mm_load_ps(v); }
+
+    MATH3D_INLINE Vec4 operator+(const Vec4 &other) const { return Vec4(_mm_add_ps(simd(), other.simd())); }
+    MATH3D_INLINE Vec4 operator-(const Vec4 &other) const { return Vec4(_mm_sub_ps(simd(), other.simd())); }
+    MATH3D_INLINE Vec4 operator*(float factor) const { return Vec4(_mm_mul_ps(simd(), _mm_set1_ps(factor))); }
+#else
+    MATH3D_INLINE Vec4 operator+(const Vec4 &o) const { return Vec4(v[0] + o.v[0], v[1] + o.v[1], v[2] + o.v[2], v[3] + o.v[3]); }
+    MATH3D_INLINE Vec4 operator-(const Vec4 &o) const { return Vec4(v[0] - o.v[0], v[1] - o.v[1], v[2] - o.v[2], v[3] - o.v[3]); }
+    MATH3D_INLINE Vec4 operator*(float f) const { return Vec4(v[0] * f, v[1] * f, v[2] * f, v[3] * f); }
+#endif
+};
+
+MATH3D_INLINE float dot(const Vec4 &a, const Vec4 &b)
+{
+#ifdef MATH3D_SSE
+    __m128 product = _mm_mul_ps(a.simd(), b.simd());
+    __m128 pairs = _mm_add_ps(product, _mm_movehl_ps(product, product)); // x+z, y+w
+    return _mm_cvtss_f32(_mm_add_ss(pairs, _mm_shuffle_ps(pairs, pairs, _MM_SHUFFLE(1, 1, 1, 1))));
+#else
+    return a.v[0] * b.v[0] + a.v[1] * b.v[1] + a.v[2] * b.v[2] + a.v[3] * b.v[3];
+#endif
+}
+
+MATH3D_INLINE Vec4 min(const Vec4 &a, const Vec4 &b)
+{
+#ifdef MATH3D_SSE
+    return Vec4(_mm_min_ps(a.simd(), b.simd()));
+#else
+    return Vec4(fminf(a.v[0], b.v[0]), fminf(a.v[1], b.v[1]), fminf(a.v[2], b.v[2]), fminf(a.v[3], b.v[3]));
+#endif
+}
+
+MATH3D_INLINE Vec4 max(const Vec4 &a, const Vec4 &b)
+{
+#ifdef MATH3D_SSE
+    return Vec4(_mm_max_ps(a.simd(), b.simd()));
+#else
+    return Vec4(fmaxf(a.v[0], b.v[0]), fmaxf(a.v[1], b.v[1]), fmaxf(a.v[2], b.v[2]), fmaxf(a.v[3], b.v[3]));
+#endif
+}
+
+MATH3D_INLINE Vec4 reflect(const Vec4 &v, const Vec4 &n)
+{
+    return v - n * (2.f * dot(v, n));
+}
+
+/* 4x4 float matrix, column-major like OpenGL (m[column * 4 + row]).
+   The product uses SSE when available, one column per register. */
+class Mat4
+{
+public:
+    alignas(16) float m[16];
+
+    const float *data() const { return m; }
+
+    static Mat4 identity()
+    {
+        Mat4 result;
+        for (int i = 0; i < 16; i++)
+        {
+            result.m[i] = (i % 5 == 0) ? 1.f : 0.f;
+        }
+        return result;
+    }
+
+    static Mat4 translation(float x, float y, float z)
+    {
+        Mat4 result = identity();
+        result.m[12] = x;
+        result.m[13] = y;
+        result.m[14] = z;
+        return result;
+    }
+
+    static Mat4 scaling(float x, float y, float z)
+    {
+        Mat4 result = identity();
+        result.m[0] = x;
+        result.m[5] = y;
+        result.m[10] = z;
+        return result;
+    }
+
+    // Same as glRotatef: angle in degrees around (x, y, z)
+    static Mat4 rotation(float angle, float x, float y, float z)
+    {
+        Mat4 result = identity();
+        float norm = sqrtf(x * x + y * y + z * z);
+        if (norm == 0.f)
+        {
+            return result;
+        }
+        x /= norm;
+        y /= norm;
+        z /= norm;
+        float radians = angle * 3.14159265358979f / 180.f;
+        float c = cosf(radians);
+        float s = sinf(radians);
+        float t = 1.f - c;
+        const float rotation[16] = {
+            x * x * t + c, y * x * t + z * s, x * z * t - y * s, 0.f,
+            x * y * t - z * s, y * y * t + c, y * z * t + x * s, 0.f,
+            x * z * t + y * s, y * z * t - x * s, z * z * t + c, 0.f,
+            0.f, 0.f, 0.f, 1.f};
+        for (int i = 0; i < 16; i++)
+        {
+            result.m[i] = rotation[i];
+        }
+        return result;
+    }
+
+    // Same as gluPerspective: vertical field of view in degrees
+    static Mat4 perspective(float fovy, float aspectRatio, float zNear, float zFar)
+    {
+        Mat4 result;
+        for (int i = 0; i < 16; i++)
+        {
+            result.m[i] = 0.f;
+        }
+        float f = 1.f / tanf(fovy * 3.14159265358979f / 360.f); // 1/tan(fovy/2)
+        result.m[0] = f / aspectRatio;
+        result.m[5] = f;
+        result.m[10] = -(zFar + zNear) / (zFar - zNear);
+        result.m[11] = -1.f;
+        result.m[14] = -2.f * zFar * zNear / (zFar - zNear);
+        return result;
+    }
+
+    static Mat4 fromArray(const float mat[16])
+    {
+        Mat4 result;
+        for (int i = 0; i < 16; i++)
+        {
+            result.m[i] = mat[i];
+        }
+        return result;
+    }
+
+    // this * other (other is applied first, as with glMultMatrixf)
+    Mat4 operator*(const Mat4 &other) const
+    {
+        Mat4 result;
+        multiply(m, other.m, result.m);
+        return result;
+    }
+
+    Vec4 operator*(const Vec4 &vector) const
+    {
+        return transform(m, vector);
+    }
+
+    // mat * vector, mat in the layout of Mat4::m (a matrix stack top for instance)
+    static MATH3D_INLINE Vec4 transform(const float mat[16], const Vec4 &vector)
+    {
+#ifdef MATH3D_SSE
+        __m128 xy = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(mat), _mm_set1_ps(vector.v[0])), _mm_mul_ps(_mm_loadu_ps(mat + 4), _mm_set1_ps(vector.v[1])));
+        __m128 zw = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(mat + 8), _mm_set1_ps(vector.v[2])), _mm_mul_ps(_mm_loadu_ps(mat + 12), _mm_set1_ps(vector.v[3])));
+        return Vec4(_mm_add_ps(xy, zw));
+#else
+        float result[4];
+        for (int row = 0; row < 4; row++)
+        {
+            result[row] = mat[row] * vector.v[0] + mat[4 + row] * vector.v[1] + mat[8 + row] * vector.v[2] + mat[12 + row] * vector.v[3];
+        }
+        return Vec4(result[0], result[1], result[2], result[3]);
+#endif
+    }
+
+    bool operator==(const Mat4 &other) const
+    {
+        for (int i = 0; i < 16; i++)
+        {
+            if (m[i] != other.m[i])
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool operator!=(const Mat4 &other) const { return !(*this == other); }
+
+    // result = a * b, result may alias a or b
+    static void multiply(const float a[16], const float b[16], float result[16])
+    {
+#ifdef MATH3D_SSE
+        __m128 col0 = _mm_loadu_ps(a);
+        __m128 col1 = _mm_loadu_ps(a + 4);
+        __m128 col2 = _mm_loadu_ps(a + 8);
+        __m128 col3 = _mm_loadu_ps(a + 12);
+        __m128 columns[4];
+        for (int col = 0; col < 4; col++)
+        {
+            const float *bc = b + 4 * col;
+            columns[col] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(col0, _mm_set1_ps(bc[0])), _mm_mul_ps(col1, _mm_set1_ps(bc[1]))),
+                                      _mm_add_ps(_mm_mul_ps(col2, _mm_set1_ps(bc[2])), _mm_mul_ps(col3, _mm_set1_ps(bc[3]))));
+        }
+        for (int col = 0; col < 4; col++)
+        {
+            _mm_storeu_ps(result + 4 * col, columns[col]);
+        }
+#else
+        float product[16];
+        for (int col = 0; col < 4; col++)
+        {
+            for (int row = 0; row < 4; row++)
+            {
+                product[col * 4 + row] = a[row] * b[col * 4] + a[4 + row] * b[col * 4 + 1] +
+                                         a[8 + row] * b[col * 4 + 2] + a[12 + row] * b[col * 4 + 3];
+            }
+        }
+        for (int i = 0; i < 16; i++)
+        {
+            result[i] = product[i];
+        }
+#endif
+    }
+};
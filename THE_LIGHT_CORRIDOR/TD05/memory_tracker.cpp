@@ -0,0 +1,234 @@
+#include "memory_tracker.hpp"
+#include "logger.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<long> allocationCount{0};
+static std::atomic<long> allocatedBytes{0};
+
+AllocationCounters allocationCounters()
+{
+    AllocationCounters counters = {allocationCount.load(std::memory_order_relaxed), allocatedBytes.load(std::memory_order_relaxed)};
+    return counters;
+}
+
+#ifdef MEMORY_TAGS_ENABLED
+
+static const char *TAG_NAMES[NB_MEMORY_TAGS] = {"untagged", "generation", "simulation", "rendering", "assets", "logging"};
+
+/* Stored in front of every allocation, 16 bytes keep the alignment of malloc */
+class AllocationHeader
+{
+public:
+    std::size_t size;
+    MEMORY_TAGS tag;
+};
+static const std::size_t HEADER_SIZE = 16;
+static_assert(sizeof(AllocationHeader) <= HEADER_SIZE, "allocation header too large");
+
+class TagCounters
+{
+public:
+    std::atomic<long> allocations;
+    std::atomic<long> frees;
+    std::atomic<long> bytes;
+    std::atomic<long> live;
+    std::atomic<long> peak;
+
+    // Churn, updated by memoryFrameFinished() only
+    long allocationsAtFirstFrame;
+    long bytesAtFirstFrame;
+    long allocationsAtFrameStart;
+    long bytesAtFrameStart;
+    long maxFrameAllocations;
+    long maxFrameBytes;
+};
+
+// Zero initialized before any allocation can happen
+static TagCounters tagCounters[NB_MEMORY_TAGS];
+static TagCounters total;
+static long frames = 0;
+
+static thread_local MEMORY_TAGS currentTag = MEMORY_TAG_UNTAGGED;
+
+MemoryTagScope::MemoryTagScope(MEMORY_TAGS tag)
+    : previous{currentTag}
+{
+    currentTag = tag;
+}
+
+MemoryTagScope::~MemoryTagScope()
+{
+    currentTag = previous;
+}
+
+static void raisePeak(TagCounters &counters, long live)
+{
+    long peak = counters.peak.load(std::memory_order_relaxed);
+    while (live > peak && !counters.peak.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+    {
+    }
+}
+
+static void count(TagCounters &counters, long size)
+{
+    counters.allocations.fetch_add(1, std::memory_order_relaxed);
+    counters.bytes.fetch_add(size, std::memory_order_relaxed);
+    raisePeak(counters, counters.live.fetch_add(size, std::memory_order_relaxed) + size);
+}
+
+static void *allocate(std::size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    AllocationHeader *header = (AllocationHeader *)std::malloc(HEADER_SIZE + size);
+    if (!header)
+    {
+        return NULL;
+    }
+    header->size = size;
+    header->tag = currentTag;
+    count(tagCounters[header->tag], size);
+    count(total, size);
+    return (char *)header + HEADER_SIZE;
+}
+
+static void release(void *memory)
+{
+    if (!memory)
+    {
+        return;
+    }
+    AllocationHeader *header = (AllocationHeader *)((char *)memory - HEADER_SIZE);
+    TagCounters &counters = tagCounters[header->tag];
+    counters.frees.fetch_add(1, std::memory_order_relaxed);
+    counters.live.fetch_sub(header->size, std::memory_order_relaxed);
+    total.frees.fetch_add(1, std::memory_order_relaxed);
+    total.live.fetch_sub(header->size, std::memory_order_relaxed);
+    std::free(header);
+}
+
+static void frameFinished(TagCounters &counters)
+{
+    long allocations = counters.allocations.load(std::memory_order_relaxed);
+    long bytes = counters.bytes.load(std::memory_order_relaxed);
+    if (frames == 0)
+    {
+        counters.allocationsAtFirstFrame = allocations;
+        counters.bytesAtFirstFrame = bytes;
+    }
+    else
+    {
+        counters.maxFrameAllocations = std::max(counters.maxFrameAllocations, allocations - counters.allocationsAtFrameStart);
+        counters.maxFrameBytes = std::max(counters.maxFrameBytes, bytes - counters.bytesAtFrameStart);
+    }
+    counters.allocationsAtFrameStart = allocations;
+    counters.bytesAtFrameStart = bytes;
+}
+
+// The first call only marks the start of the first frame
+void memoryFrameFinished()
+{
+    for (int tag = 0; tag < NB_MEMORY_TAGS; tag++)
+    {
+        frameFinished(tagCounters[tag]);
+    }
+    frameFinished(total);
+    frames++;
+}
+
+static void reportLine(const char *name, const TagCounters &counters)
+{
+    long allocations = counters.allocations.load(std::memory_order_relaxed);
+    long bytes = counters.bytes.load(std::memory_order_relaxed);
+    long frameCount = frames - 1; // frames between the first and the last call
+    double perFrameAllocations = frameCount > 0 ? (counters.allocationsAtFrameStart - counters.allocationsAtFirstFrame) / (double)frameCount : 0.;
+    double perFrameBytes = frameCount > 0 ? (counters.bytesAtFrameStart - counters.bytesAtFirstFrame) / (double)frameCount : 0.;
+    LOG_INFO("memory %-10s %8ld allocs %8ld frees %11ld bytes  live %9ld  peak %9ld  per frame %7.1f allocs (max %ld) %9.0f bytes (max %ld)",
+             name, allocations, counters.frees.load(std::memory_order_relaxed), bytes,
+             counters.live.load(std::memory_order_relaxed), counters.peak.load(std::memory_order_relaxed),
+             perFrameAllocations, counters.maxFrameAllocations, perFrameBytes, counters.maxFrameBytes);
+}
+
+void printMemoryReport()
+{
+    LOG_INFO("memory report, %ld frames", frames > 0 ? frames - 1 : 0);
+    for (int tag = 0; tag < NB_MEMORY_TAGS; tag++)
+    {
+        reportLine(TAG_NAMES[tag], tagCounters[tag]);
+    }
+    reportLine("total", total);
+}
+
+#else
+
+static void *allocate(std::size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    return std::malloc(size > 0 ? size : 1);
+}
+
+static void release(void *memory)
+{
+    std::free(memory);
+}
+
+void memoryFrameFinished()
+{
+}
+
+void printMemoryReport()
+{
+    AllocationCounters counters = allocationCounters();
+    LOG_INFO("memory: %ld allocations, %ld bytes (per subsystem report: build with LIGHT_CORRIDOR_MEMORY_TAGS)", counters.count, counters.bytes);
+}
+
+#endif
+
+void *operator new(std::size_t size)
+{
+    void *memory = allocate(size);
+    if (!memory)
+    {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void *operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+    return allocate(size);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept
+{
+    return allocate(size);
+}
+
+void operator delete(void *memory) noexcept
+{
+    release(memory);
+}
+
+void operator delete[](void *memory) noexcept
+{
+    release(memory);
+}
+
+void operator delete(void *memory, const std::nothrow_t &) noexcept
+{
+    release(memory);
+}
+
+void operator delete[](void *memory, const std::nothrow_t &) noexcept
+{
+    release(memory);
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+/* Counts the allocations made through the global operator new / new[]
+   (this translation unit replaces them). Counters only ever grow: the
+   allocations of a frame are the difference of two snapshots. */
+class AllocationCounters
+{
+public:
+    long count;
+    long bytes;
+};
+
+AllocationCounters allocationCounters();
+
+/* Subsystems the allocations are attributed to */
+enum MEMORY_TAGS
+{
+    MEMORY_TAG_UNTAGGED,
+    MEMORY_TAG_GENERATION, // level loading: corridor, obstacles
+    MEMORY_TAG_SIMULATION,
+    MEMORY_TAG_RENDERING,
+    MEMORY_TAG_ASSETS,     // shaders, meshes
+    MEMORY_TAG_LOGGING,
+    NB_MEMORY_TAGS
+};
+
+/* Per subsystem tracking, built only with the CMake option
+   LIGHT_CORRIDOR_MEMORY_TAGS: every allocation then carries a small
+   header with its size and tag, so frees, live bytes and peaks are known
+   per tag. MEMORY_TAG(tag) attributes the allocations of the calling
+   thread to tag until the end of the enclosing block (the innermost tag
+   wins); it compiles to nothing otherwise. */
+#ifdef MEMORY_TAGS_ENABLED
+
+class MemoryTagScope
+{
+public:
+    explicit MemoryTagScope(MEMORY_TAGS tag);
+    ~MemoryTagScope();
+
+    MemoryTagScope(const MemoryTagScope &) = delete;
+    MemoryTagScope &operator=(const MemoryTagScope &) = delete;
+
+private:
+    MEMORY_TAGS previous;
+};
+
+#define MEMORY_TAG_CONCAT_(a, b) a##b
+#define MEMORY_TAG_CONCAT(a, b) MEMORY_TAG_CONCAT_(a, b)
+#define MEMORY_TAG(tag) MemoryTagScope MEMORY_TAG_CONCAT(memoryTag, __LINE__)(tag)
+
+#else
+
+#define MEMORY_TAG(tag) \
+    do                  \
+    {                   \
+    } while (0)
+
+#endif
+
+// End of a frame: per tag churn (allocations and bytes since the last call)
+void memoryFrameFinished();
+
+// Counts, bytes, live and peak bytes and per frame churn of every tag,
+// one log line per tag (totals only without LIGHT_CORRIDOR_MEMORY_TAGS)
+void printMemoryReport();
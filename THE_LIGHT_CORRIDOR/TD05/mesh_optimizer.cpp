@@ -0,0 +1,396 @@
+#include "mesh_optimizer.hpp"
+#include "memory_tracker.hpp"
+#include "logger.hpp"
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <map>
+
+/* Quantization */
+
+static short quantize(float value)
+{
+    value = std::max(-1.f, std::min(1.f, value));
+    return (short)lroundf(value * 32767.f);
+}
+
+static float dequantize(short value)
+{
+    return value / 32767.f;
+}
+
+IndexedMesh buildIndexedMesh(const float *vertices, int strips, int stripLength)
+{
+    IndexedMesh mesh;
+
+    // Bounding radius, so that positions use the full 16 bits range
+    float scale = 0.f;
+    for (int i = 0; i < 3 * strips * stripLength; i++)
+    {
+        scale = std::max(scale, std::abs(vertices[i]));
+    }
+    mesh.scale = scale > 0.f ? scale : 1.f;
+
+    std::map<std::vector<short>, unsigned short> welded;
+    std::vector<unsigned short> remap(strips * stripLength);
+    for (int i = 0; i < strips * stripLength; i++)
+    {
+        const float *vertex = &vertices[3 * i];
+        std::vector<short> key(4, 0);
+        for (int k = 0; k < 3; k++)
+        {
+            key[k] = quantize(vertex[k] / mesh.scale);
+        }
+
+        std::map<std::vector<short>, unsigned short>::iterator found = welded.find(key);
+        if (found != welded.end())
+        {
+            remap[i] = found->second;
+            continue;
+        }
+
+        unsigned short index = mesh.vertexCount();
+        welded[key] = index;
+        remap[i] = index;
+        mesh.positions.insert(mesh.positions.end(), key.begin(), key.end());
+    }
+
+    // Strips to triangle list, keeping a consistent winding
+    for (int strip = 0; strip < strips; strip++)
+    {
+        for (int i = 0; i + 2 < stripLength; i++)
+        {
+            unsigned short a = remap[strip * stripLength + i];
+            unsigned short b = remap[strip * stripLength + i + 1];
+            unsigned short c = remap[strip * stripLength + i + 2];
+            if (a == b || b == c || a == c)
+            {
+                continue;
+            }
+            if (i % 2 == 1)
+            {
+                std::swap(a, b);
+            }
+            mesh.indices.push_back(a);
+            mesh.indices.push_back(b);
+            mesh.indices.push_back(c);
+        }
+    }
+    return mesh;
+}
+
+/* Vertex cache optimization (Forsyth, "Linear-Speed Vertex Cache Optimisation") */
+
+static const int FORSYTH_CACHE_SIZE = 32;
+
+static float vertexScore(int cachePosition, int remainingTriangles)
+{
+    if (remainingTriangles == 0)
+    {
+        return -1.f;
+    }
+    float score = 0.f;
+    if (cachePosition >= 0)
+    {
+        if (cachePosition < 3)
+        {
+            score = 0.75f; // vertices of the last triangle
+        }
+        else
+        {
+            float scaler = 1.f / (FORSYTH_CACHE_SIZE - 3);
+            score = powf(1.f - (cachePosition - 3) * scaler, 1.5f);
+        }
+    }
+    // Favor vertices with few triangles left, to finish them off
+    return score + 2.f * powf((float)remainingTriangles, -0.5f);
+}
+
+void optimizeVertexCache(IndexedMesh &mesh)
+{
+    int vertexCount = mesh.vertexCount();
+    int triangleCount = mesh.triangleCount();
+    if (triangleCount == 0)
+    {
+        return;
+    }
+
+    // Triangles using each vertex
+    std::vector<int> remaining(vertexCount, 0);
+    for (size_t i = 0; i < mesh.indices.size(); i++)
+    {
+        remaining[mesh.indices[i]]++;
+    }
+    std::vector<int> offsets(vertexCount + 1, 0);
+    for (int v = 0; v < vertexCount; v++)
+    {
+        offsets[v + 1] = offsets[v] + remaining[v];
+    }
+    std::vector<int> adjacency(mesh.indices.size());
+    std::vector<int> filled(offsets.begin(), offsets.end() - 1);
+    for (int t = 0; t < triangleCount; t++)
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            adjacency[filled[mesh.indices[3 * t + k]]++] = t;
+        }
+    }
+
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> score(vertexCount);
+    for (int v = 0; v < vertexCount; v++)
+    {
+        score[v] = vertexScore(-1, remaining[v]);
+    }
+    std::vector<float> triangleScore(triangleCount, 0.f);
+    std::vector<bool> emitted(triangleCount, false);
+    for (int t = 0; t < triangleCount; t++)
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            triangleScore[t] += score[mesh.indices[3 * t + k]];
+        }
+    }
+
+    std::vector<unsigned short> result;
+    result.reserve(mesh.indices.size());
+    std::vector<int> cache;
+    int best = std::max_element(triangleScore.begin(), triangleScore.end()) - triangleScore.begin();
+
+    while (best >= 0)
+    {
+        emitted[best] = true;
+        std::vector<int> newCache;
+        for (int k = 0; k < 3; k++)
+        {
+            int v = mesh.indices[3 * best + k];
+            result.push_back(v);
+            newCache.push_back(v);
+            remaining[v]--;
+        }
+        for (size_t i = 0; i < cache.size(); i++)
+        {
+            if (std::find(newCache.begin(), newCache.end(), cache[i]) == newCache.end())
+            {
+                newCache.push_back(cache[i]);
+            }
+        }
+
+        // Rescore the vertices that were or are in the cache, and their triangles
+        for (size_t i = 0; i < newCache.size(); i++)
+        {
+            int v = newCache[i];
+            cachePosition[v] = i < (size_t)FORSYTH_CACHE_SIZE ? (int)i : -1;
+            float newScore = vertexScore(cachePosition[v], remaining[v]);
+            float delta = newScore - score[v];
+            score[v] = newScore;
+            for (int a = offsets[v]; a < offsets[v + 1]; a++)
+            {
+                triangleScore[adjacency[a]] += delta;
+            }
+        }
+        if (newCache.size() > (size_t)FORSYTH_CACHE_SIZE)
+        {
+            newCache.resize(FORSYTH_CACHE_SIZE);
+        }
+        cache.swap(newCache);
+
+        // Best triangle among those touching the cache, full scan if none is left
+        best = -1;
+        float bestScore = -1e30f;
+        for (size_t i = 0; i < cache.size(); i++)
+        {
+            int v = cache[i];
+            for (int a = offsets[v]; a < offsets[v + 1]; a++)
+            {
+                int t = adjacency[a];
+                if (!emitted[t] && triangleScore[t] > bestScore)
+                {
+                    bestScore = triangleScore[t];
+                    best = t;
+                }
+            }
+        }
+        if (best < 0)
+        {
+            for (int t = 0; t < triangleCount; t++)
+            {
+                if (!emitted[t] && triangleScore[t] > bestScore)
+                {
+                    bestScore = triangleScore[t];
+                    best = t;
+                }
+            }
+        }
+    }
+    mesh.indices.swap(result);
+}
+
+/* Overdraw: the cache ordered triangles are cut into clusters where the
+   simulated cache starts cold (all three vertices missed), so moving a
+   cluster costs almost no cache efficiency. Clusters are then drawn most
+   outward facing first, so the back of the object fails the depth test. */
+
+static const int OVERDRAW_CACHE_SIZE = 16;
+static const int OVERDRAW_MIN_CLUSTER = 8; // triangles
+
+static std::vector<int> clusterStarts(const IndexedMesh &mesh)
+{
+    std::vector<int> starts;
+    std::deque<int> fifo;
+    int clusterSize = 0;
+    for (int t = 0; t < mesh.triangleCount(); t++)
+    {
+        int misses = 0;
+        for (int k = 0; k < 3; k++)
+        {
+            int v = mesh.indices[3 * t + k];
+            if (std::find(fifo.begin(), fifo.end(), v) == fifo.end())
+            {
+                misses++;
+                fifo.push_back(v);
+                if ((int)fifo.size() > OVERDRAW_CACHE_SIZE)
+                {
+                    fifo.pop_front();
+                }
+            }
+        }
+        if (t == 0 || (misses == 3 && clusterSize >= OVERDRAW_MIN_CLUSTER))
+        {
+            starts.push_back(t);
+            clusterSize = 0;
+        }
+        clusterSize++;
+    }
+    starts.push_back(mesh.triangleCount());
+    return starts;
+}
+
+void optimizeOverdraw(IndexedMesh &mesh)
+{
+    int triangleCount = mesh.triangleCount();
+    int vertexCount = mesh.vertexCount();
+    if (triangleCount == 0)
+    {
+        return;
+    }
+
+    float meshCenter[3] = {0.f, 0.f, 0.f};
+    for (int v = 0; v < vertexCount; v++)
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            meshCenter[k] += dequantize(mesh.positions[4 * v + k]) / vertexCount;
+        }
+    }
+
+    std::vector<int> starts = clusterStarts(mesh);
+    std::vector<std::pair<float, int>> clusters; // (sort key, cluster)
+    for (size_t c = 0; c + 1 < starts.size(); c++)
+    {
+        int first = starts[c];
+        int last = starts[c + 1];
+        float center[3] = {0.f, 0.f, 0.f};
+        float normal[3] = {0.f, 0.f, 0.f};
+        for (int t = first; t < last; t++)
+        {
+            float p[3][3];
+            for (int corner = 0; corner < 3; corner++)
+            {
+                for (int k = 0; k < 3; k++)
+                {
+                    p[corner][k] = dequantize(mesh.positions[4 * mesh.indices[3 * t + corner] + k]);
+                    center[k] += p[corner][k] / (3 * (last - first));
+                }
+            }
+            // Area weighted face normal
+            float e1[3] = {p[1][0] - p[0][0], p[1][1] - p[0][1], p[1][2] - p[0][2]};
+            float e2[3] = {p[2][0] - p[0][0], p[2][1] - p[0][1], p[2][2] - p[0][2]};
+            normal[0] += e1[1] * e2[2] - e1[2] * e2[1];
+            normal[1] += e1[2] * e2[0] - e1[0] * e2[2];
+            normal[2] += e1[0] * e2[1] - e1[1] * e2[0];
+        }
+        float facing = 0.f;
+        for (int k = 0; k < 3; k++)
+        {
+            facing += (center[k] - meshCenter[k]) * normal[k];
+        }
+        float length = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        clusters.push_back(std::make_pair(length > 0.f ? facing / length : 0.f, (int)c));
+    }
+
+    std::stable_sort(clusters.begin(), clusters.end(),
+                     [](const std::pair<float, int> &a, const std::pair<float, int> &b)
+                     { return a.first > b.first; });
+
+    std::vector<unsigned short> result;
+    result.reserve(mesh.indices.size());
+    for (size_t c = 0; c < clusters.size(); c++)
+    {
+        int first = starts[clusters[c].second];
+        int last = starts[clusters[c].second + 1];
+        result.insert(result.end(), mesh.indices.begin() + 3 * first, mesh.indices.begin() + 3 * last);
+    }
+    mesh.indices.swap(result);
+}
+
+void optimizeVertexFetch(IndexedMesh &mesh)
+{
+    int vertexCount = mesh.vertexCount();
+    std::vector<int> remap(vertexCount, -1);
+    std::vector<short> positions;
+    positions.reserve(mesh.positions.size());
+
+    int next = 0;
+    for (size_t i = 0; i < mesh.indices.size(); i++)
+    {
+        int v = mesh.indices[i];
+        if (remap[v] < 0)
+        {
+            remap[v] = next++;
+            positions.insert(positions.end(), mesh.positions.begin() + 4 * v, mesh.positions.begin() + 4 * v + 4);
+        }
+        mesh.indices[i] = remap[v];
+    }
+    // Unreferenced vertices are dropped
+    mesh.positions.swap(positions);
+}
+
+// Post-transform cache measured in the log, a common hardware FIFO size
+static const int ACMR_CACHE_SIZE = 16;
+
+float averageCacheMissRatio(const IndexedMesh &mesh, int cacheSize)
+{
+    if (mesh.triangleCount() == 0)
+    {
+        return 0.f;
+    }
+    std::deque<int> fifo;
+    int misses = 0;
+    for (size_t i = 0; i < mesh.indices.size(); i++)
+    {
+        if (std::find(fifo.begin(), fifo.end(), mesh.indices[i]) == fifo.end())
+        {
+            misses++;
+            fifo.push_back(mesh.indices[i]);
+            if ((int)fifo.size() > cacheSize)
+            {
+                fifo.pop_front();
+            }
+        }
+    }
+    return misses / (float)mesh.triangleCount();
+}
+
+IndexedMesh buildOptimizedMesh(const float *vertices, int strips, int stripLength)
+{
+    MEMORY_TAG(MEMORY_TAG_ASSETS);
+    IndexedMesh mesh = buildIndexedMesh(vertices, strips, stripLength);
+    float stripOrderRatio = averageCacheMissRatio(mesh, ACMR_CACHE_SIZE);
+    optimizeVertexCache(mesh);
+    optimizeOverdraw(mesh);
+    optimizeVertexFetch(mesh);
+    LOG_INFO("MESH: %d triangles, %d vertices, cache miss ratio %.2f -> %.2f (FIFO of %d)", mesh.triangleCount(),
+             mesh.vertexCount(), stripOrderRatio, averageCacheMissRatio(mesh, ACMR_CACHE_SIZE), ACMR_CACHE_SIZE);
+    return mesh;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <vector>
+
+/* Indexed triangle mesh with 16 bits quantized positions.
+   Positions are signed normalized shorts (value / 32767), padded to 4
+   components so every vertex is 8 bytes aligned. */
+class IndexedMesh
+{
+public:
+    std::vector<short> positions; // x, y, z, 0 per vertex, in [-scale, scale]
+    std::vector<unsigned short> indices;
+    float scale = 1.f; // positions are stored divided by scale
+
+    int vertexCount() const { return positions.size() / 4; }
+    int triangleCount() const { return indices.size() / 3; }
+};
+
+/* Load-time mesh optimizations, run once per cached primitive */
+
+// Build an indexed mesh from triangle strips (strips * stripLength (x, y, z) floats).
+// Vertices equal after quantization (strip seams, sphere poles) are merged and the
+// triangles that become degenerate are dropped.
+IndexedMesh buildIndexedMesh(const float *vertices, int strips, int stripLength);
+
+// Reorder triangles for the post-transform vertex cache (Tom Forsyth's algorithm)
+void optimizeVertexCache(IndexedMesh &mesh);
+
+// Reorder clusters of cache-ordered triangles so that the outward facing ones
+// come first (simplified Sander et al. 2007), which lowers overdraw
+void optimizeOverdraw(IndexedMesh &mesh);
+
+// Renumber vertices in order of first use, for linear vertex fetches
+void optimizeVertexFetch(IndexedMesh &mesh);
+
+// Average cache miss ratio (transformed vertices per triangle) for a FIFO cache
+float averageCacheMissRatio(const IndexedMesh &mesh, int cacheSize);
+
+// All of the above, in the right order (the ratio before and after is logged)
+IndexedMesh buildOptimizedMesh(const float *vertices, int strips, int stripLength);
@@ -0,0 +1,259 @@
+#include "glad/glad.h"
+#include "overlay.hpp"
+#include "benchmark.hpp"
+#include "shader.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+
+/* 3x5 pixels font, one row per byte (bit 2 is the left column) */
+static const char FONT_CHARS[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ.:-%";
+static const unsigned char FONT[][5] = {
+    {7, 5, 5, 5, 7}, {2, 6, 2, 2, 7}, {7, 1, 7, 4, 7}, {7, 1, 7, 1, 7}, {5, 5, 7, 1, 1},
+    {7, 4, 7, 1, 7}, {7, 4, 7, 5, 7}, {7, 1, 1, 1, 1}, {7, 5, 7, 5, 7}, {7, 5, 7, 1, 7},
+    {2, 5, 7, 5, 5}, {6, 5, 6, 5, 6}, {3, 4, 4, 4, 3}, {6, 5, 5, 5, 6}, {7, 4, 6, 4, 7},
+    {7, 4, 6, 4, 4}, {3, 4, 5, 5, 3}, {5, 5, 7, 5, 5}, {7, 2, 2, 2, 7}, {1, 1, 1, 5, 2},
+    {5, 5, 6, 5, 5}, {4, 4, 4, 4, 7}, {5, 7, 7, 5, 5}, {6, 5, 5, 5, 5}, {2, 5, 5, 5, 2},
+    {6, 5, 6, 4, 4}, {2, 5, 5, 6, 3}, {6, 5, 6, 5, 5}, {3, 4, 2, 1, 6}, {7, 2, 2, 2, 2},
+    {5, 5, 5, 5, 7}, {5, 5, 5, 5, 2}, {5, 5, 7, 7, 5}, {5, 5, 2, 5, 5}, {5, 5, 2, 2, 2},
+    {7, 1, 2, 4, 7}, {0, 0, 0, 0, 2}, {0, 2, 0, 2, 0}, {0, 0, 7, 0, 0}, {5, 1, 2, 4, 5},
+};
+
+/* Layout, in pixels */
+static const float MARGIN = 8.f;
+static const float PADDING = 6.f;
+static const float FONT_PIXEL = 2.f;
+static const float CHAR_ADVANCE = 4 * FONT_PIXEL;
+static const float LINE_HEIGHT = 7 * FONT_PIXEL;
+static const float GRAPH_HEIGHT = 60.f; // twice the budget
+static const int TEXT_LINES = 3;
+
+static const unsigned char PANEL_COLOR[4] = {0, 0, 0, 160};
+static const unsigned char TEXT_COLOR[4] = {255, 255, 255, 255};
+static const unsigned char UNDER_BUDGET_COLOR[4] = {60, 200, 60, 255};
+static const unsigned char OVER_BUDGET_COLOR[4] = {230, 50, 50, 255};
+static const unsigned char BUDGET_COLOR[4] = {240, 220, 60, 255};
+
+static const char *OVERLAY_VERTEX_SHADER =
+    "#version 120\n"
+    "uniform vec2 uViewport;\n"
+    "attribute vec2 aPosition;\n"
+    "attribute vec4 aColor;\n"
+    "varying vec4 vColor;\n"
+    "void main()\n"
+    "{\n"
+    "    vColor = aColor;\n"
+    "    gl_Position = vec4(aPosition.x / uViewport.x * 2.0 - 1.0, 1.0 - aPosition.y / uViewport.y * 2.0, 0.0, 1.0);\n"
+    "}\n";
+
+static const char *OVERLAY_FRAGMENT_SHADER =
+    "#version 120\n"
+    "varying vec4 vColor;\n"
+    "void main()\n"
+    "{\n"
+    "    gl_FragColor = vColor;\n"
+    "}\n";
+
+PerfOverlay::PerfOverlay(double budgetMs)
+    : budget{budgetMs}
+{
+}
+
+PerfOverlay::~PerfOverlay()
+{
+    if (program)
+    {
+        glDeleteBuffers(1, &vbo);
+        glDeleteVertexArrays(1, &vao);
+        glDeleteProgram(program);
+    }
+}
+
+bool PerfOverlay::openCsv(const std::string &path, double intervalSeconds)
+{
+    csv.open(path.c_str());
+    if (!csv)
+    {
+        return false;
+    }
+    csv << "time_s,frames,frame_ms,frame_p99_ms,draw_calls,vertices,obstacles_tested,allocations" << std::endl;
+    csvInterval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(intervalSeconds));
+    csvStart = std::chrono::steady_clock::now();
+    csvNext = csvStart + csvInterval;
+    return true;
+}
+
+void PerfOverlay::frameFinished(const OverlaySample &sample)
+{
+    if ((int)history.size() < HISTORY)
+    {
+        history.push_back(sample);
+    }
+    else
+    {
+        history[frames % HISTORY] = sample;
+    }
+    frames++;
+
+    if (csv.is_open())
+    {
+        interval.push_back(sample);
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (now >= csvNext)
+        {
+            writeCsvRow();
+            // Fixed cadence, without a burst of rows after a stall
+            csvNext += csvInterval;
+            if (csvNext <= now)
+            {
+                csvNext = now + csvInterval;
+            }
+        }
+    }
+}
+
+// Per frame averages (p99 for the frame time) of the samples of the interval
+void PerfOverlay::writeCsvRow()
+{
+    std::vector<double> frameMs;
+    double drawCalls = 0., vertexCount = 0., obstaclesTested = 0., allocations = 0.;
+    for (size_t i = 0; i < interval.size(); i++)
+    {
+        frameMs.push_back(interval[i].frameMs);
+        drawCalls += interval[i].drawCalls;
+        vertexCount += interval[i].vertices;
+        obstaclesTested += interval[i].obstaclesTested;
+        allocations += interval[i].allocations;
+    }
+    double count = interval.size();
+    double average = 0.;
+    for (size_t i = 0; i < frameMs.size(); i++)
+    {
+        average += frameMs[i] / count;
+    }
+    csv << std::chrono::duration<double>(std::chrono::steady_clock::now() - csvStart).count() << ','
+        << interval.size() << ',' << average << ',' << percentile(frameMs, 99) << ','
+        << drawCalls / count << ',' << vertexCount / count << ','
+        << obstaclesTested / count << ',' << allocations / count << std::endl;
+    interval.clear();
+}
+
+bool PerfOverlay::createPass()
+{
+    const char *attribs[] = {"aPosition", "aColor", NULL};
+    program = ::createProgram(OVERLAY_VERTEX_SHADER, OVERLAY_FRAGMENT_SHADER, attribs);
+    if (!program)
+    {
+        return false;
+    }
+    viewportLocation = glGetUniformLocation(program, "uViewport");
+
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &vbo);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, x));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), (void *)offsetof(Vertex, rgba));
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return true;
+}
+
+void PerfOverlay::addRect(float x, float y, float width, float height, const unsigned char rgba[4])
+{
+    const float corners[6][2] = {{x, y}, {x + width, y}, {x, y + height}, {x + width, y}, {x + width, y + height}, {x, y + height}};
+    for (int i = 0; i < 6; i++)
+    {
+        Vertex vertex;
+        vertex.x = corners[i][0];
+        vertex.y = corners[i][1];
+        std::memcpy(vertex.rgba, rgba, 4);
+        vertices.push_back(vertex);
+    }
+}
+
+// One rectangle per lit font pixel, unknown characters are blank
+void PerfOverlay::addText(float x, float y, const std::string &text, const unsigned char rgba[4])
+{
+    for (size_t c = 0; c < text.size(); c++)
+    {
+        const char *found = std::strchr(FONT_CHARS, text[c]);
+        if (text[c] != '\0' && found)
+        {
+            const unsigned char *glyph = FONT[found - FONT_CHARS];
+            for (int row = 0; row < 5; row++)
+            {
+                for (int column = 0; column < 3; column++)
+                {
+                    if (glyph[row] & (4 >> column))
+                    {
+                        addRect(x + column * FONT_PIXEL, y + row * FONT_PIXEL, FONT_PIXEL, FONT_PIXEL, rgba);
+                    }
+                }
+            }
+        }
+        x += CHAR_ADVANCE;
+    }
+}
+
+void PerfOverlay::draw(Renderer &renderer, int width, int height)
+{
+    if (!visible || history.empty() || !renderer.usesGL() || (!program && !createPass()))
+    {
+        return;
+    }
+
+    // Oldest sample first
+    std::vector<double> frameMs;
+    for (size_t i = 0; i < history.size(); i++)
+    {
+        frameMs.push_back(history[(frames + i) % history.size()].frameMs);
+    }
+    const OverlaySample &last = history[(frames - 1) % history.size()];
+
+    std::ostringstream lines[TEXT_LINES];
+    lines[0] << std::fixed << std::setprecision(2) << "FRAME " << last.frameMs << " MS  P99 " << percentile(frameMs, 99) << " MS";
+    lines[1] << "DRAWS " << last.drawCalls << "  VERTS " << last.vertices;
+    lines[2] << "TESTS " << last.obstaclesTested << "  ALLOCS " << last.allocations;
+
+    vertices.clear();
+    float graphY = MARGIN + PADDING + TEXT_LINES * LINE_HEIGHT;
+    addRect(MARGIN, MARGIN, HISTORY + 2 * PADDING, TEXT_LINES * LINE_HEIGHT + GRAPH_HEIGHT + 2 * PADDING, PANEL_COLOR);
+    for (int i = 0; i < TEXT_LINES; i++)
+    {
+        addText(MARGIN + PADDING, MARGIN + PADDING + i * LINE_HEIGHT, lines[i].str(), TEXT_COLOR);
+    }
+    for (size_t i = 0; i < frameMs.size(); i++)
+    {
+        float bar = std::min(GRAPH_HEIGHT, (float)(frameMs[i] / (2 * budget) * GRAPH_HEIGHT));
+        addRect(MARGIN + PADDING + i, graphY + GRAPH_HEIGHT - bar, 1.f, bar, frameMs[i] > budget ? OVER_BUDGET_COLOR : UNDER_BUDGET_COLOR);
+    }
+    addRect(MARGIN + PADDING, graphY + GRAPH_HEIGHT / 2, HISTORY, 1.f, BUDGET_COLOR);
+
+    renderer.flush();
+    GLboolean blend = glIsEnabled(GL_BLEND);
+    GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    glDisable(GL_DEPTH_TEST);
+    glUseProgram(program);
+    glUniform2f(viewportLocation, (float)width, (float)height);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STREAM_DRAW);
+    glDrawArrays(GL_TRIANGLES, 0, vertices.size());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+    glUseProgram(0);
+    if (!blend)
+    {
+        glDisable(GL_BLEND);
+    }
+    if (depthTest)
+    {
+        glEnable(GL_DEPTH_TEST);
+    }
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "renderer.hpp"
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/* Counters of one frame */
+class OverlaySample
+{
+public:
+    double frameMs;       // simulation + draw + swap, without the pacing wait
+    long drawCalls;
+    long vertices;
+    int obstaclesTested;  // by the collision tick of the frame
+    long allocations;     // global operator new calls during the frame
+};
+
+/* Live performance overlay: frame time graph of the last HISTORY frames
+   (green under the budget, red over it), p99 and the counters of the last
+   frame, in the top left corner. The whole overlay is one vertex buffer
+   upload and one draw call, after the scene, and is not counted in the
+   renderer stats it shows.
+   The same counters can be appended to a CSV every few seconds (averages
+   over the interval), whether the overlay is shown or not. */
+class PerfOverlay
+{
+public:
+    static const int HISTORY = 240;
+
+    explicit PerfOverlay(double budgetMs);
+    ~PerfOverlay();
+
+    PerfOverlay(const PerfOverlay &) = delete;
+    PerfOverlay &operator=(const PerfOverlay &) = delete;
+
+    bool visible = false;
+
+    // CSV of the counters every intervalSeconds, returns false if the file
+    // cannot be written
+    bool openCsv(const std::string &path, double intervalSeconds);
+
+    void frameFinished(const OverlaySample &sample);
+    // Draw over the current framebuffer (GL renderers only)
+    void draw(Renderer &renderer, int width, int height);
+
+private:
+    double budget;
+    std::vector<OverlaySample> history; // ring of HISTORY samples
+    long frames = 0;
+
+    std::ofstream csv;
+    std::chrono::steady_clock::duration csvInterval;
+    std::chrono::steady_clock::time_point csvStart;
+    std::chrono::steady_clock::time_point csvNext;
+    std::vector<OverlaySample> interval; // samples since the last CSV row
+
+    // Colored 2D triangles in pixels, rebuilt every drawn frame
+    class Vertex
+    {
+    public:
+        float x, y;
+        unsigned char rgba[4];
+    };
+    std::vector<Vertex> vertices;
+    unsigned int program = 0;
+    unsigned int vao = 0;
+    unsigned int vbo = 0;
+    int viewportLocation = -1;
+
+    bool createPass();
+    void writeCsvRow();
+    void addRect(float x, float y, float width, float height, const unsigned char rgba[4]);
+    void addText(float x, float y, const std::string &text, const unsigned char rgba[4]);
+};
@@ -0,0 +1,247 @@
+#include "perf_baseline.hpp"
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+class BaselineEntry
+{
+public:
+    std::string name;
+    double baseline = 0.;
+    double tolerance = 0.;
+    bool hasLimit = false;
+    double limit = 0.;
+    bool higherIsBetter = true;
+};
+
+/* Reader for the baseline files: an object of objects holding numbers and
+   strings, which is all they use (no arrays, escapes or nesting deeper) */
+class BaselineParser
+{
+public:
+    explicit BaselineParser(const std::string &source)
+        : text{source}
+    {
+    }
+
+    bool parse(std::vector<BaselineEntry> *entries)
+    {
+        if (!accept('{'))
+        {
+            return false;
+        }
+        if (peek() == '}')
+        {
+            return accept('}');
+        }
+        do
+        {
+            BaselineEntry entry;
+            if (!readString(&entry.name) || !accept(':') || !readEntry(&entry))
+            {
+                return false;
+            }
+            entries->push_back(entry);
+        } while (accept(','));
+        return accept('}');
+    }
+
+    std::string error() const
+    {
+        std::ostringstream message;
+        message << "syntax error at offset " << position;
+        return message.str();
+    }
+
+private:
+    const std::string &text;
+    size_t position = 0;
+
+    char peek()
+    {
+        while (position < text.size() && std::isspace((unsigned char)text[position]))
+        {
+            position++;
+        }
+        return position < text.size() ? text[position] : '\0';
+    }
+
+    bool accept(char c)
+    {
+        if (peek() != c)
+        {
+            return false;
+        }
+        position++;
+        return true;
+    }
+
+    bool readString(std::string *value)
+    {
+        if (!accept('"'))
+        {
+            return false;
+        }
+        size_t end = text.find('"', position);
+        if (end == std::string::npos)
+        {
+            return false;
+        }
+        *value = text.substr(position, end - position);
+        position = end + 1;
+        return true;
+    }
+
+    bool readNumber(double *value)
+    {
+        peek();
+        const char *start = text.c_str() + position;
+        char *end = NULL;
+        *value = std::strtod(start, &end);
+        if (end == start)
+        {
+            return false;
+        }
+        position += end - start;
+        return true;
+    }
+
+    bool readEntry(BaselineEntry *entry)
+    {
+        if (!accept('{'))
+        {
+            return false;
+        }
+        do
+        {
+            std::string key;
+            if (!readString(&key) || !accept(':'))
+            {
+                return false;
+            }
+            if (key == "better")
+            {
+                std::string better;
+                if (!readString(&better) || (better != "higher" && better != "lower"))
+                {
+                    return false;
+                }
+                entry->higherIsBetter = better == "higher";
+            }
+            else if (key == "baseline" || key == "tolerance")
+            {
+                if (!readNumber(key == "baseline" ? &entry->baseline : &entry->tolerance))
+                {
+                    return false;
+                }
+            }
+            else if (key == "limit")
+            {
+                if (!readNumber(&entry->limit))
+                {
+                    return false;
+                }
+                entry->hasLimit = true;
+            }
+            else if (key == "note")
+            {
+                std::string note;
+                if (!readString(&note))
+                {
+                    return false;
+                }
+            }
+            else
+            {
+                return false;
+            }
+        } while (accept(','));
+        return accept('}');
+    }
+};
+
+bool writeMetricsJson(const std::string &path, const std::vector<Metric> &metrics)
+{
+    std::ofstream json(path.c_str());
+    if (!json)
+    {
+        return false;
+    }
+    json << "{";
+    for (size_t i = 0; i < metrics.size(); i++)
+    {
+        json << (i > 0 ? ",\n " : "\n ") << '"' << metrics[i].name << "\": " << metrics[i].value;
+    }
+    json << "\n}" << std::endl;
+    return true;
+}
+
+int compareWithBaseline(const std::string &path, const std::vector<Metric> &metrics, double toleranceScale)
+{
+    std::ifstream file(path.c_str());
+    if (!file)
+    {
+        std::cout << "Cannot read baseline " << path << std::endl;
+        return -1;
+    }
+    std::stringstream content;
+    content << file.rdbuf();
+    std::string text = content.str();
+
+    std::vector<BaselineEntry> entries;
+    BaselineParser parser(text);
+    if (!parser.parse(&entries))
+    {
+        std::cout << path << ": " << parser.error() << std::endl;
+        return -1;
+    }
+
+    int regressions = 0;
+    char line[160];
+    std::snprintf(line, sizeof(line), "%-24s %14s %14s %9s %16s  %s", "metric", "baseline", "measured", "change", "limit", "status");
+    std::cout << "baseline " << path << std::endl
+              << line << std::endl;
+    for (size_t e = 0; e < entries.size(); e++)
+    {
+        const BaselineEntry &entry = entries[e];
+        const Metric *metric = NULL;
+        for (size_t m = 0; m < metrics.size() && !metric; m++)
+        {
+            if (metrics[m].name == entry.name)
+            {
+                metric = &metrics[m];
+            }
+        }
+        if (!metric)
+        {
+            std::snprintf(line, sizeof(line), "%-24s %14.3f %14s %9s %16s  %s", entry.name.c_str(), entry.baseline, "-", "", "", "MISSING");
+            std::cout << line << std::endl;
+            regressions++;
+            continue;
+        }
+
+        double margin = std::fabs(entry.baseline) * entry.tolerance * toleranceScale;
+        double limit = entry.higherIsBetter ? entry.baseline - margin : entry.baseline + margin;
+        if (entry.hasLimit)
+        {
+            limit = entry.limit;
+        }
+        bool regressed = entry.higherIsBetter ? metric->value < limit : metric->value > limit;
+        char change[16] = "";
+        if (entry.baseline != 0.)
+        {
+            std::snprintf(change, sizeof(change), "%+.1f%%", (metric->value - entry.baseline) / std::fabs(entry.baseline) * 100.);
+        }
+        char bound[32];
+        std::snprintf(bound, sizeof(bound), "%s %.3f", entry.higherIsBetter ? ">=" : "<=", limit);
+        std::snprintf(line, sizeof(line), "%-24s %14.3f %14.3f %9s %16s  %s", entry.name.c_str(), entry.baseline, metric->value,
+                      change, bound, regressed ? "REGRESSION" : "ok");
+        std::cout << line << std::endl;
+        regressions += regressed;
+    }
+    return regressions;
+}
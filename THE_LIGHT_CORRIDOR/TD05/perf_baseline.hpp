@@ -0,0 +1,30 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+/* One measured value of a benchmark run */
+class Metric
+{
+public:
+    std::string name;
+    double value;
+};
+
+// {"name": value, ...}, returns false if the file cannot be written
+bool writeMetricsJson(const std::string &path, const std::vector<Metric> &metrics);
+
+/* Compares a run with a checked in baseline file of the form
+     {
+       "ticks_per_second": {"baseline": 250000, "tolerance": 0.5, "better": "higher"},
+       "allocations_per_tick": {"baseline": 3, "limit": 4, "better": "lower", "note": "why 4"}
+     }
+   A metric regresses when it is worse than baseline by more than
+   tolerance (a fraction of the baseline, multiplied by toleranceScale),
+   or worse than limit when given: an absolute bound for deterministic
+   counters, which toleranceScale does not change. note is free text
+   explaining the values.
+   Prints a table of every baseline metric and returns the number of
+   regressions (metrics missing from the run count as regressions), or -1
+   if the baseline cannot be read. */
+int compareWithBaseline(const std::string &path, const std::vector<Metric> &metrics, double toleranceScale);
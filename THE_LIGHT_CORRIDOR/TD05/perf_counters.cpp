@@ -0,0 +1,227 @@
+#include "perf_counters.hpp"
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#ifdef __linux__
+#include <cerrno>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+static const char *EVENT_NAMES[NB_PERF_EVENTS] = {"cycles", "instructions", "L1D misses", "LLC misses", "branch misses"};
+
+static bool enabled = false;
+static thread_local bool countingThread = false;
+static std::vector<PerfRegion> regions;
+
+// Index of each event in the group read, -1 when it is not counted
+static int groupIndex[NB_PERF_EVENTS] = {-1, -1, -1, -1, -1};
+static int groupSize = 0;
+
+#ifdef __linux__
+
+class EventConfig
+{
+public:
+    unsigned int type;
+    unsigned long long config;
+};
+
+static const EventConfig EVENTS[NB_PERF_EVENTS] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+    {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+};
+
+static int fds[NB_PERF_EVENTS] = {-1, -1, -1, -1, -1};
+static int groupFd = -1;
+
+static int openEvent(const EventConfig &event, int group)
+{
+    perf_event_attr attributes;
+    std::memset(&attributes, 0, sizeof(attributes));
+    attributes.size = sizeof(attributes);
+    attributes.type = event.type;
+    attributes.config = event.config;
+    attributes.disabled = group == -1; // the whole group starts with its leader
+    attributes.exclude_kernel = 1;
+    attributes.exclude_hv = 1;
+    attributes.read_format = PERF_FORMAT_GROUP;
+    return syscall(SYS_perf_event_open, &attributes, 0, -1, group, 0);
+}
+
+// Current value of every event of the group, false if the read failed
+static bool readGroup(long long values[NB_PERF_EVENTS])
+{
+    unsigned long long buffer[1 + NB_PERF_EVENTS];
+    if (read(groupFd, buffer, sizeof(buffer)) < (ssize_t)(sizeof(unsigned long long) * (1 + groupSize)))
+    {
+        return false;
+    }
+    for (int i = 0; i < NB_PERF_EVENTS; i++)
+    {
+        values[i] = groupIndex[i] >= 0 ? (long long)buffer[1 + groupIndex[i]] : 0;
+    }
+    return true;
+}
+
+bool startPerfCounters(std::string *error)
+{
+    stopPerfCounters();
+    regions.clear();
+    groupSize = 0;
+    int firstError = 0;
+    for (int i = 0; i < NB_PERF_EVENTS; i++)
+    {
+        groupIndex[i] = -1;
+    }
+    for (int i = 0; i < NB_PERF_EVENTS; i++)
+    {
+        fds[i] = openEvent(EVENTS[i], groupFd);
+        if (fds[i] < 0)
+        {
+            firstError = firstError ? firstError : errno;
+            continue;
+        }
+        if (groupFd < 0)
+        {
+            groupFd = fds[i];
+        }
+        groupIndex[i] = groupSize++;
+    }
+    if (groupFd < 0)
+    {
+        *error = std::string("perf_event_open: ") + std::strerror(firstError);
+        return false;
+    }
+    ioctl(groupFd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(groupFd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    enabled = true;
+    countingThread = true;
+    return true;
+}
+
+void stopPerfCounters()
+{
+    enabled = false;
+    countingThread = false;
+    for (int i = 0; i < NB_PERF_EVENTS; i++)
+    {
+        if (fds[i] >= 0)
+        {
+            close(fds[i]);
+        }
+        fds[i] = -1;
+    }
+    groupFd = -1;
+}
+
+#else
+
+static bool readGroup(long long *)
+{
+    return false;
+}
+
+bool startPerfCounters(std::string *error)
+{
+    *error = "hardware counters are only read on Linux";
+    return false;
+}
+
+void stopPerfCounters()
+{
+}
+
+#endif
+
+PerfRegionScope::PerfRegionScope(const char *regionName)
+    : name{regionName}, counting{enabled && countingThread}
+{
+    if (counting)
+    {
+        counting = readGroup(start);
+    }
+}
+
+PerfRegionScope::~PerfRegionScope()
+{
+    long long end[NB_PERF_EVENTS];
+    if (!counting || !readGroup(end))
+    {
+        return;
+    }
+    PerfRegion *region = NULL;
+    for (size_t i = 0; i < regions.size() && !region; i++)
+    {
+        if (std::strcmp(regions[i].name, name) == 0)
+        {
+            region = &regions[i];
+        }
+    }
+    if (!region)
+    {
+        regions.push_back(PerfRegion());
+        region = &regions.back();
+        region->name = name;
+    }
+    region->calls++;
+    for (int i = 0; i < NB_PERF_EVENTS; i++)
+    {
+        region->counts[i] += end[i] - start[i];
+    }
+}
+
+bool perfEventAvailable(PERF_EVENTS event)
+{
+    return groupIndex[event] >= 0;
+}
+
+const std::vector<PerfRegion> &perfRegions()
+{
+    return regions;
+}
+
+void printPerfReport()
+{
+    if (regions.empty())
+    {
+        return;
+    }
+    std::cout << "hardware counters per call (user space, main thread):" << std::endl;
+    char line[256];
+    std::snprintf(line, sizeof(line), "%-16s %8s %12s %12s %6s %12s %12s %12s", "region", "calls",
+                  EVENT_NAMES[PERF_CYCLES], EVENT_NAMES[PERF_INSTRUCTIONS], "IPC",
+                  EVENT_NAMES[PERF_L1D_MISSES], EVENT_NAMES[PERF_LLC_MISSES], EVENT_NAMES[PERF_BRANCH_MISSES]);
+    std::cout << line << std::endl;
+    for (size_t r = 0; r < regions.size(); r++)
+    {
+        const PerfRegion &region = regions[r];
+        char cells[NB_PERF_EVENTS][16];
+        for (int i = 0; i < NB_PERF_EVENTS; i++)
+        {
+            if (perfEventAvailable((PERF_EVENTS)i))
+            {
+                std::snprintf(cells[i], sizeof(cells[i]), "%.1f", region.counts[i] / (double)region.calls);
+            }
+            else
+            {
+                std::snprintf(cells[i], sizeof(cells[i]), "n/a");
+            }
+        }
+        char ipc[16] = "n/a";
+        if (perfEventAvailable(PERF_CYCLES) && perfEventAvailable(PERF_INSTRUCTIONS) && region.counts[PERF_CYCLES] > 0)
+        {
+            std::snprintf(ipc, sizeof(ipc), "%.2f", region.counts[PERF_INSTRUCTIONS] / (double)region.counts[PERF_CYCLES]);
+        }
+        std::snprintf(line, sizeof(line), "%-16s %8ld %12s %12s %6s %12s %12s %12s", region.name, region.calls,
+                      cells[PERF_CYCLES], cells[PERF_INSTRUCTIONS], ipc,
+                      cells[PERF_L1D_MISSES], cells[PERF_LLC_MISSES], cells[PERF_BRANCH_MISSES]);
+        std::cout << line << std::endl;
+    }
+}
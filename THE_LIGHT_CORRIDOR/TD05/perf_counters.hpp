@@ -0,0 +1,65 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+/* Hardware events counted around the measured regions */
+enum PERF_EVENTS
+{
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_L1D_MISSES,
+    PERF_LLC_MISSES,
+    PERF_BRANCH_MISSES,
+    NB_PERF_EVENTS
+};
+
+/* Totals of one region over all its calls */
+class PerfRegion
+{
+public:
+    const char *name;
+    long calls = 0;
+    long long counts[NB_PERF_EVENTS] = {0};
+};
+
+/* Linux perf_event_open counters (user space only) of the calling thread,
+   read as one group so every event covers the same instructions.
+   PERF_REGION("name") adds the events of the rest of the enclosing block
+   to the region "name" when the counters were started with
+   startPerfCounters(), and only costs a test of a flag otherwise. Regions
+   run on other threads (command recording workers) are not counted.
+   Events the CPU, kernel or container does not give are reported as
+   unavailable; without perf_event_open (other systems, or
+   kernel.perf_event_paranoid too strict) nothing is counted. */
+class PerfRegionScope
+{
+public:
+    explicit PerfRegionScope(const char *regionName);
+    ~PerfRegionScope();
+
+    PerfRegionScope(const PerfRegionScope &) = delete;
+    PerfRegionScope &operator=(const PerfRegionScope &) = delete;
+
+private:
+    const char *name;
+    bool counting;
+    long long start[NB_PERF_EVENTS];
+};
+
+#define PERF_CONCAT_(a, b) a##b
+#define PERF_CONCAT(a, b) PERF_CONCAT_(a, b)
+#define PERF_REGION(name) PerfRegionScope PERF_CONCAT(perfRegion, __LINE__)(name)
+
+// Open the counters for the calling thread and enable the regions.
+// Returns false, with the reason in *error, if no event can be counted.
+bool startPerfCounters(std::string *error);
+void stopPerfCounters();
+
+// Whether each event is counted by the last startPerfCounters()
+bool perfEventAvailable(PERF_EVENTS event);
+
+const std::vector<PerfRegion> &perfRegions();
+
+// Per call cycles, instructions, IPC and misses of every region
+void printPerfReport();
@@ -0,0 +1,146 @@
+#include "profiler.hpp"
+
+#ifdef PROFILER_ENABLED
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+/* Zones kept per thread, a power of two */
+static const unsigned long RING_SIZE = 1 << 16;
+
+class ProfileEvent
+{
+public:
+    const char *name;
+    long long start;    // ns since the profiler epoch
+    long long duration; // ns
+};
+
+/* Written by its thread only: the event goes in first, then the head is
+   published. The dump reads the head again after copying and drops the
+   events that may have been overwritten meanwhile. */
+class ProfileRing
+{
+public:
+    int id;
+    std::atomic<const char *> threadName;
+    std::atomic<unsigned long> head;
+    ProfileEvent events[RING_SIZE];
+
+    explicit ProfileRing(int ringId)
+        : id{ringId}, threadName{NULL}, head{0}
+    {
+    }
+};
+
+static const Clock::time_point epoch = Clock::now();
+
+// Every ring ever created, rings outlive their thread so a dump still sees
+// the zones of the workers which are gone
+static std::mutex registryMutex;
+static std::vector<ProfileRing *> rings;
+
+static thread_local ProfileRing *threadRing = NULL;
+
+static ProfileRing *currentRing()
+{
+    if (!threadRing)
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        threadRing = new ProfileRing(rings.size() + 1);
+        rings.push_back(threadRing);
+    }
+    return threadRing;
+}
+
+ProfileZone::~ProfileZone()
+{
+    Clock::time_point end = Clock::now();
+    ProfileRing *ring = currentRing();
+    unsigned long index = ring->head.load(std::memory_order_relaxed);
+    ProfileEvent &event = ring->events[index & (RING_SIZE - 1)];
+    event.name = name;
+    event.start = std::chrono::duration_cast<std::chrono::nanoseconds>(start - epoch).count();
+    event.duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    ring->head.store(index + 1, std::memory_order_release);
+}
+
+void profilerSetThreadName(const char *name)
+{
+    currentRing()->threadName.store(name);
+}
+
+bool profilerWriteTrace(const std::string &path)
+{
+    std::ofstream json(path.c_str());
+    if (!json)
+    {
+        return false;
+    }
+
+    std::vector<ProfileRing *> snapshot;
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        snapshot = rings;
+    }
+
+    json << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[" << std::fixed << std::setprecision(3);
+    bool first = true;
+    for (size_t r = 0; r < snapshot.size(); r++)
+    {
+        ProfileRing &ring = *snapshot[r];
+        const char *threadName = ring.threadName.load();
+        json << (first ? "\n" : ",\n")
+             << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << ring.id
+             << ",\"args\":{\"name\":\"" << (threadName ? threadName : "thread") << "\"}}";
+        first = false;
+
+        unsigned long end = ring.head.load(std::memory_order_acquire);
+        unsigned long begin = end > RING_SIZE ? end - RING_SIZE : 0;
+        std::vector<ProfileEvent> events;
+        for (unsigned long i = begin; i < end; i++)
+        {
+            events.push_back(ring.events[i & (RING_SIZE - 1)]);
+        }
+        // Events overwritten while they were copied
+        unsigned long after = ring.head.load(std::memory_order_acquire);
+        size_t skip = after > begin + RING_SIZE ? std::min<unsigned long>(after - begin - RING_SIZE, events.size()) : 0;
+
+        for (size_t i = skip; i < events.size(); i++)
+        {
+            json << ",\n{\"name\":\"" << events[i].name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << ring.id
+                 << ",\"ts\":" << events[i].start / 1000. << ",\"dur\":" << events[i].duration / 1000. << "}";
+        }
+    }
+    json << "\n]}" << std::endl;
+    return true;
+}
+
+bool profilerEnabled()
+{
+    return true;
+}
+
+#else
+
+void profilerSetThreadName(const char *)
+{
+}
+
+bool profilerWriteTrace(const std::string &)
+{
+    return false;
+}
+
+bool profilerEnabled()
+{
+    return false;
+}
+
+#endif
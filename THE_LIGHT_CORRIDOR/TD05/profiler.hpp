@@ -0,0 +1,59 @@
+#pragma once
+
+#include <string>
+
+/* Scoped-zone CPU profiler.
+   PROFILE_ZONE("name") times the rest of the enclosing block. Every thread
+   writes its zones to its own ring buffer (the last RING_SIZE zones are
+   kept) and profilerWriteTrace() dumps all of them as a Chrome trace_event
+   JSON file (chrome://tracing, https://ui.perfetto.dev).
+   Built only with the CMake option LIGHT_CORRIDOR_PROFILER, the macros
+   compile to nothing otherwise. Zone names must be string literals. */
+
+#ifdef PROFILER_ENABLED
+
+#include <chrono>
+
+class ProfileZone
+{
+public:
+    explicit ProfileZone(const char *zoneName)
+        : name{zoneName}, start{std::chrono::steady_clock::now()}
+    {
+    }
+    ~ProfileZone();
+
+    ProfileZone(const ProfileZone &) = delete;
+    ProfileZone &operator=(const ProfileZone &) = delete;
+
+private:
+    const char *name;
+    std::chrono::steady_clock::time_point start;
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define PROFILE_THREAD(name) profilerSetThreadName(name)
+
+#else
+
+#define PROFILE_ZONE(name) \
+    do                     \
+    {                      \
+    } while (0)
+#define PROFILE_THREAD(name) \
+    do                       \
+    {                        \
+    } while (0)
+
+#endif
+
+// Name of the calling thread in the trace (string literal)
+void profilerSetThreadName(const char *name);
+
+// Write the zones of every thread, returns false if the file cannot be
+// written or the profiler is not built in
+bool profilerWriteTrace(const std::string &path);
+
+bool profilerEnabled();
@@ -0,0 +1,645 @@
+#include "glad/glad.h"
+#include "renderer.hpp"
+#include "3D_tools.hpp"
+#include "shader.hpp"
+#include "impostor.hpp"
+#include "mesh_optimizer.hpp"
+#include "math3d.hpp"
+#include <algorithm>
+#include <cstring>
+
+/* Matrix stack */
+
+static void identity(float m[16])
+{
+    for (int i = 0; i < 16; i++)
+    {
+        m[i] = (i % 5 == 0) ? 1.f : 0.f;
+    }
+}
+
+MatrixStack::MatrixStack()
+    : stack(1)
+{
+    identity(stack.back().m);
+}
+
+void MatrixStack::loadIdentity()
+{
+    identity(stack.back().m);
+}
+
+void MatrixStack::loadMatrix(const float mat[16])
+{
+    memcpy(stack.back().m, mat, sizeof(float) * 16);
+}
+
+void MatrixStack::push()
+{
+    stack.push_back(stack.back());
+}
+
+void MatrixStack::pop()
+{
+    if (stack.size() > 1)
+    {
+        stack.pop_back();
+    }
+}
+
+// top = top * mat (same as glMultMatrixf)
+void MatrixStack::multiply(const float mat[16])
+{
+    float *m = stack.back().m;
+    Mat4::multiply(m, mat, m);
+}
+
+void MatrixStack::translate(float x, float y, float z)
+{
+    float *m = stack.back().m;
+    for (int row = 0; row < 4; row++)
+    {
+        m[12 + row] += m[row] * x + m[4 + row] * y + m[8 + row] * z;
+    }
+}
+
+void MatrixStack::rotate(float angle, float x, float y, float z)
+{
+    multiply(Mat4::rotation(angle, x, y, z).data());
+}
+
+void MatrixStack::scale(float x, float y, float z)
+{
+    float *m = stack.back().m;
+    for (int row = 0; row < 4; row++)
+    {
+        m[row] *= x;
+        m[4 + row] *= y;
+        m[8 + row] *= z;
+    }
+}
+
+/* Number of vertices sent by the immediate mode primitives of 3D_tools */
+static const int SQUARE_VERTICES = 4;
+
+static int circleVertexCount(int lod)
+{
+    return LOD_SEGMENTS[lod] + 2;
+}
+
+static int sphereStripVertexCount(int lod)
+{
+    return 2 * (LOD_SEGMENTS[lod] + 1);
+}
+
+/* Level of detail: a level is kept until the projected radius leaves its
+   range by more than LOD_HYSTERESIS */
+static const float LOD_HYSTERESIS = 0.2f;
+
+/* Renderer */
+
+Renderer::Renderer()
+{
+    identity(projection);
+}
+
+Renderer::~Renderer()
+{
+    delete impostor;
+}
+
+bool Renderer::enableSphereImpostor()
+{
+    if (usesGL() && !impostor)
+    {
+        impostor = new SphereImpostor();
+        if (!impostor->isValid())
+        {
+            delete impostor;
+            impostor = NULL;
+            return false;
+        }
+    }
+    sphereImpostor = true;
+    return true;
+}
+
+void Renderer::setViewport(int width, int height)
+{
+    viewportWidth = width;
+    viewportHeight = height;
+}
+
+void Renderer::setProjection(const float mat[16])
+{
+    memcpy(projection, mat, sizeof(projection));
+}
+
+void Renderer::drawSphere(LodState *lod)
+{
+    if (sphereImpostor)
+    {
+        drawSphereImpostor();
+    }
+    else
+    {
+        drawSphereLevel(selectLod(lod));
+    }
+}
+
+int Renderer::selectLod(LodState *lod) const
+{
+    if (!lodEnabled)
+    {
+        return LOD_HIGHEST;
+    }
+
+    // Projected radius (in pixels) of the unit object: largest scale of the
+    // model-view matrix, perspective divide by the view depth of its center
+    const float *m = modelView.top();
+    float radius = 0.f;
+    for (int col = 0; col < 3; col++)
+    {
+        radius = std::max(radius, sqrtf(m[4 * col] * m[4 * col] + m[4 * col + 1] * m[4 * col + 1] + m[4 * col + 2] * m[4 * col + 2]));
+    }
+    float depth = std::max(-m[14] - radius, Z_NEAR);
+    float pixels = radius * projection[5] / depth * viewportHeight / 2.f;
+
+    // Radius up to which a level keeps segments of lodSegmentPixels
+    float levelRadius[NB_LOD_LEVELS];
+    for (int level = 0; level < NB_LOD_LEVELS; level++)
+    {
+        levelRadius[level] = LOD_SEGMENTS[level] * lodSegmentPixels / (2 * M_PI);
+    }
+
+    int level = 0;
+    while (level < LOD_HIGHEST && pixels > levelRadius[level])
+    {
+        level++;
+    }
+    if (lod)
+    {
+        int previous = lod->level;
+        if (previous >= 0)
+        {
+            // Stay on the previous level while inside its widened range
+            float upper = levelRadius[previous] * (1.f + LOD_HYSTERESIS);
+            float lower = previous > 0 ? levelRadius[previous - 1] * (1.f - LOD_HYSTERESIS) : 0.f;
+            if (pixels <= upper && pixels >= lower)
+            {
+                level = previous;
+            }
+        }
+        lod->level = level;
+    }
+    return level;
+}
+
+/* Legacy renderer */
+
+void LegacyRenderer::setViewport(int width, int height)
+{
+    Renderer::setViewport(width, height);
+    glViewport(0, 0, width, height);
+}
+
+void LegacyRenderer::setProjection(const float mat[16])
+{
+    Renderer::setProjection(mat);
+    glMatrixMode(GL_PROJECTION);
+    glLoadMatrixf(mat);
+    glMatrixMode(GL_MODELVIEW);
+}
+
+void LegacyRenderer::loadIdentity()
+{
+    Renderer::loadIdentity();
+    glLoadIdentity();
+}
+
+void LegacyRenderer::pushMatrix()
+{
+    Renderer::pushMatrix();
+    glPushMatrix();
+}
+
+void LegacyRenderer::popMatrix()
+{
+    Renderer::popMatrix();
+    glPopMatrix();
+}
+
+void LegacyRenderer::translate(float x, float y, float z)
+{
+    Renderer::translate(x, y, z);
+    glTranslatef(x, y, z);
+}
+
+void LegacyRenderer::rotate(float angle, float x, float y, float z)
+{
+    Renderer::rotate(angle, x, y, z);
+    glRotatef(angle, x, y, z);
+}
+
+void LegacyRenderer::scale(float x, float y, float z)
+{
+    Renderer::scale(x, y, z);
+    glScalef(x, y, z);
+}
+
+void LegacyRenderer::multMatrix(const float mat[16])
+{
+    Renderer::multMatrix(mat);
+    glMultMatrixf(mat);
+}
+
+void LegacyRenderer::setColor(float r, float g, float b, float a)
+{
+    color[0] = r;
+    color[1] = g;
+    color[2] = b;
+    color[3] = a;
+    glColor4f(r, g, b, a);
+}
+
+void LegacyRenderer::setLineWidth(float width)
+{
+    glLineWidth(width);
+}
+
+void LegacyRenderer::drawSquare()
+{
+    ::drawSquare();
+    stats.drawCalls++;
+    stats.vertices += SQUARE_VERTICES;
+}
+
+void LegacyRenderer::drawEmptySquare()
+{
+    ::drawEmptySquare();
+    stats.drawCalls++;
+    stats.vertices += SQUARE_VERTICES;
+}
+
+void LegacyRenderer::drawCircleLevel(int lod)
+{
+    ::drawCircle(lod);
+    stats.drawCalls++;
+    stats.vertices += circleVertexCount(lod);
+}
+
+void LegacyRenderer::drawConeLevel(int lod)
+{
+    ::drawCone(lod);
+    stats.drawCalls++;
+    stats.vertices += circleVertexCount(lod);
+}
+
+void LegacyRenderer::drawSphereLevel(int lod)
+{
+    ::drawSphere(lod);
+    stats.drawCalls += LOD_SEGMENTS[lod];
+    stats.vertices += LOD_SEGMENTS[lod] * sphereStripVertexCount(lod);
+}
+
+void LegacyRenderer::drawSphereImpostor()
+{
+    impostor->draw(modelView.top(), projection, color);
+    stats.drawCalls++;
+    stats.vertices += SphereImpostor::VERTICES;
+}
+
+/* Batched renderer */
+
+static const char *BATCH_VERTEX_SHADER =
+    "#version 120\n"
+    "uniform mat4 uProjection;\n"
+    "attribute vec3 aPosition;\n"
+    "attribute vec4 aColor;\n"
+    "varying vec4 vColor;\n"
+    "void main()\n"
+    "{\n"
+    "    vColor = aColor;\n"
+    "    gl_Position = uProjection * vec4(aPosition, 1.0);\n"
+    "}\n";
+
+static const char *BATCH_FRAGMENT_SHADER =
+    "#version 120\n"
+    "varying vec4 vColor;\n"
+    "void main()\n"
+    "{\n"
+    "    gl_FragColor = vColor;\n"
+    "}\n";
+
+// Quantized meshes: positions are normalized shorts scaled back by uScale
+static const char *MESH_VERTEX_SHADER =
+    "#version 120\n"
+    "uniform mat4 uProjection;\n"
+    "uniform mat4 uModelView;\n"
+    "uniform float uScale;\n"
+    "attribute vec4 aPosition;\n"
+    "void main()\n"
+    "{\n"
+    "    gl_Position = uProjection * uModelView * vec4(aPosition.xyz * uScale, 1.0);\n"
+    "}\n";
+
+static const char *MESH_FRAGMENT_SHADER =
+    "#version 120\n"
+    "uniform vec4 uColor;\n"
+    "void main()\n"
+    "{\n"
+    "    gl_FragColor = uColor;\n"
+    "}\n";
+
+BatchedRenderer::BatchedRenderer()
+    : lineWidth{1.f}, batchIsLines{false}, program{0}, projectionLocation{-1}, vao{0}, vbo{0},
+      meshProgram{0}, meshProjectionLocation{-1}, meshModelViewLocation{-1}, meshColorLocation{-1},
+      meshScaleLocation{-1}, sphereMeshes(NB_LOD_LEVELS)
+{
+    color[0] = color[1] = color[2] = color[3] = 1.f;
+
+    const char *attribs[] = {"aPosition", "aColor", NULL};
+    program = createProgram(BATCH_VERTEX_SHADER, BATCH_FRAGMENT_SHADER, attribs);
+    projectionLocation = glGetUniformLocation(program, "uProjection");
+
+    meshProgram = createProgram(MESH_VERTEX_SHADER, MESH_FRAGMENT_SHADER, attribs);
+    meshProjectionLocation = glGetUniformLocation(meshProgram, "uProjection");
+    meshModelViewLocation = glGetUniformLocation(meshProgram, "uModelView");
+    meshColorLocation = glGetUniformLocation(meshProgram, "uColor");
+    meshScaleLocation = glGetUniformLocation(meshProgram, "uScale");
+
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &vbo);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)0);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)(3 * sizeof(float)));
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+BatchedRenderer::~BatchedRenderer()
+{
+    for (size_t i = 0; i < sphereMeshes.size(); i++)
+    {
+        glDeleteBuffers(1, &sphereMeshes[i].vbo);
+        glDeleteBuffers(1, &sphereMeshes[i].ibo);
+        glDeleteVertexArrays(1, &sphereMeshes[i].vao);
+    }
+    glDeleteProgram(meshProgram);
+    glDeleteBuffers(1, &vbo);
+    glDeleteVertexArrays(1, &vao);
+    glDeleteProgram(program);
+}
+
+void BatchedRenderer::beginFrame()
+{
+    Renderer::beginFrame();
+    batch.clear();
+}
+
+void BatchedRenderer::setViewport(int width, int height)
+{
+    flush();
+    Renderer::setViewport(width, height);
+    glViewport(0, 0, width, height);
+}
+
+void BatchedRenderer::setProjection(const float mat[16])
+{
+    flush();
+    Renderer::setProjection(mat);
+}
+
+void BatchedRenderer::setColor(float r, float g, float b, float a)
+{
+    color[0] = r;
+    color[1] = g;
+    color[2] = b;
+    color[3] = a;
+}
+
+void BatchedRenderer::setLineWidth(float width)
+{
+    if (width != lineWidth)
+    {
+        flush();
+        lineWidth = width;
+    }
+}
+
+void BatchedRenderer::begin(bool lines)
+{
+    if (lines != batchIsLines)
+    {
+        flush();
+        batchIsLines = lines;
+    }
+}
+
+// Transform (x, y, z) by the model-view matrix and append it to the batch
+void BatchedRenderer::emit(float x, float y, float z)
+{
+    Vec4 eye = Mat4::transform(modelView.top(), Vec4(x, y, z, 1.f));
+    Vertex vertex = {eye.x(), eye.y(), eye.z(), color[0], color[1], color[2], color[3]};
+    batch.push_back(vertex);
+}
+
+void BatchedRenderer::flush()
+{
+    if (batch.empty())
+    {
+        return;
+    }
+
+    glUseProgram(program);
+    glUniformMatrix4fv(projectionLocation, 1, GL_FALSE, projection);
+    glLineWidth(lineWidth);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, batch.size() * sizeof(Vertex), batch.data(), GL_STREAM_DRAW);
+    glDrawArrays(batchIsLines ? GL_LINES : GL_TRIANGLES, 0, batch.size());
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glUseProgram(0);
+
+    stats.drawCalls++;
+    stats.vertices += batch.size();
+    batch.clear();
+}
+
+void BatchedRenderer::drawSquare()
+{
+    begin(false);
+    emit(-0.5, -0.5, 0.0);
+    emit(0.5, -0.5, 0.0);
+    emit(0.5, 0.5, 0.0);
+    emit(-0.5, -0.5, 0.0);
+    emit(0.5, 0.5, 0.0);
+    emit(-0.5, 0.5, 0.0);
+}
+
+void BatchedRenderer::drawEmptySquare()
+{
+    const float corners[4][2] = {{-0.5f, 0.5f}, {0.5f, 0.5f}, {0.5f, -0.5f}, {-0.5f, -0.5f}};
+    begin(true);
+    for (int i = 0; i < 4; i++)
+    {
+        emit(corners[i][0], corners[i][1], 0.0);
+        emit(corners[(i + 1) % 4][0], corners[(i + 1) % 4][1], 0.0);
+    }
+}
+
+void BatchedRenderer::drawCircleLevel(int lod)
+{
+    const float *circle = circleVertices(lod);
+    begin(false);
+    for (int i = 0; i < LOD_SEGMENTS[lod]; i++)
+    {
+        emit(0.0, 0.0, 0.0);
+        emit(circle[2 * i], circle[2 * i + 1], 0.0);
+        emit(circle[2 * i + 2], circle[2 * i + 3], 0.0);
+    }
+}
+
+void BatchedRenderer::drawConeLevel(int lod)
+{
+    const float *circle = circleVertices(lod);
+    begin(false);
+    for (int i = 0; i < LOD_SEGMENTS[lod]; i++)
+    {
+        emit(0.0, 0.0, 1.0);
+        emit(circle[2 * i], circle[2 * i + 1], 0.0);
+        emit(circle[2 * i + 2], circle[2 * i + 3], 0.0);
+    }
+}
+
+// The band strips of 3D_tools are welded into one indexed mesh, optimized
+// once for the vertex cache and overdraw, then drawn from static buffers
+void BatchedRenderer::drawSphereLevel(int lod)
+{
+    if (meshProgram == 0)
+    {
+        return;
+    }
+
+    GpuMesh &gpu = sphereMeshes[lod];
+    if (gpu.vao == 0)
+    {
+        IndexedMesh mesh = buildOptimizedMesh(sphereVertices(lod), LOD_SEGMENTS[lod], sphereStripVertexCount(lod));
+        gpu.indexCount = mesh.indices.size();
+        gpu.vertexCount = mesh.vertexCount();
+        gpu.scale = mesh.scale;
+
+        glGenVertexArrays(1, &gpu.vao);
+        glGenBuffers(1, &gpu.vbo);
+        glGenBuffers(1, &gpu.ibo);
+        glBindVertexArray(gpu.vao);
+        glBindBuffer(GL_ARRAY_BUFFER, gpu.vbo);
+        glBufferData(GL_ARRAY_BUFFER, mesh.positions.size() * sizeof(short), mesh.positions.data(), GL_STATIC_DRAW);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 4, GL_SHORT, GL_TRUE, 4 * sizeof(short), (void *)0);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, gpu.ibo);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indices.size() * sizeof(unsigned short), mesh.indices.data(), GL_STATIC_DRAW);
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    flush();
+    glUseProgram(meshProgram);
+    glUniformMatrix4fv(meshProjectionLocation, 1, GL_FALSE, projection);
+    glUniformMatrix4fv(meshModelViewLocation, 1, GL_FALSE, modelView.top());
+    glUniform4fv(meshColorLocation, 1, color);
+    glUniform1f(meshScaleLocation, gpu.scale);
+    glBindVertexArray(gpu.vao);
+    glDrawElements(GL_TRIANGLES, gpu.indexCount, GL_UNSIGNED_SHORT, (void *)0);
+    glBindVertexArray(0);
+    glUseProgram(0);
+
+    stats.drawCalls++;
+    stats.vertices += gpu.vertexCount;
+}
+
+void BatchedRenderer::drawSphereImpostor()
+{
+    flush();
+    impostor->draw(modelView.top(), projection, color);
+    stats.drawCalls++;
+    stats.vertices += SphereImpostor::VERTICES;
+}
+
+/* Null renderer */
+
+void NullRenderer::drawSquare()
+{
+    stats.drawCalls++;
+    stats.vertices += SQUARE_VERTICES;
+}
+
+void NullRenderer::drawEmptySquare()
+{
+    stats.drawCalls++;
+    stats.vertices += SQUARE_VERTICES;
+}
+
+void NullRenderer::drawCircleLevel(int lod)
+{
+    stats.drawCalls++;
+    stats.vertices += circleVertexCount(lod);
+}
+
+void NullRenderer::drawConeLevel(int lod)
+{
+    stats.drawCalls++;
+    stats.vertices += circleVertexCount(lod);
+}
+
+void NullRenderer::drawSphereLevel(int lod)
+{
+    stats.drawCalls += LOD_SEGMENTS[lod];
+    stats.vertices += LOD_SEGMENTS[lod] * sphereStripVertexCount(lod);
+}
+
+void NullRenderer::drawSphereImpostor()
+{
+    stats.drawCalls++;
+    stats.vertices += SphereImpostor::VERTICES;
+}
+
+/* Factory */
+
+bool parseRendererBackend(const char *name, RENDERER_BACKENDS *backend)
+{
+    if (strcmp(name, "legacy") == 0)
+    {
+        *backend = RENDERER_LEGACY;
+    }
+    else if (strcmp(name, "batched") == 0)
+    {
+        *backend = RENDERER_BATCHED;
+    }
+    else if (strcmp(name, "null") == 0)
+    {
+        *backend = RENDERER_NULL;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+Renderer *createRenderer(RENDERER_BACKENDS backend)
+{
+    switch (backend)
+    {
+    case RENDERER_BATCHED:
+        return new BatchedRenderer();
+    case RENDERER_NULL:
+        return new NullRenderer();
+    default:
+        return new LegacyRenderer();
+    }
+}
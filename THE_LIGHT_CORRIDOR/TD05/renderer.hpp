@@ -0,0 +1,256 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+class SphereImpostor;
+
+/* Renderer backends, selectable with --renderer on the command line */
+enum RENDERER_BACKENDS
+{
+    RENDERER_LEGACY,  // immediate mode, fixed-function matrices (original behavior)
+    RENDERER_BATCHED, // CPU transformed vertices streamed into a VBO, one draw per state change
+    RENDERER_NULL     // no GL at all, only counts what would have been drawn
+};
+
+/* What has been submitted since the last beginFrame() */
+class RenderStats
+{
+public:
+    long drawCalls = 0;
+    long vertices = 0;
+
+    void reset()
+    {
+        drawCalls = 0;
+        vertices = 0;
+    }
+};
+
+/* Column-major 4x4 matrix stack, same conventions as the GL one */
+class MatrixStack
+{
+public:
+    MatrixStack();
+
+    const float *top() const { return stack.back().m; }
+    void loadIdentity();
+    void loadMatrix(const float mat[16]);
+    void push();
+    void pop();
+    void multiply(const float mat[16]);
+    void translate(float x, float y, float z);
+    void rotate(float angle, float x, float y, float z);
+    void scale(float x, float y, float z);
+
+private:
+    struct Matrix
+    {
+        float m[16];
+    };
+    std::vector<Matrix> stack;
+};
+
+/* Level of detail state of one drawn object, keeps the previous level so
+   that the choice only changes past a hysteresis margin (no popping) */
+class LodState
+{
+public:
+    int level = -1; // -1: not chosen yet
+};
+
+/* Interface consumed by the draw_scene functions.
+   Transformations only apply to the model-view matrix, the projection is
+   set once with setProjection(). Every backend keeps a CPU copy of both so
+   the level of detail can be chosen the same way everywhere. */
+class Renderer
+{
+public:
+    RenderStats stats;
+
+    // Level of detail of the round objects: when enabled, the tessellation
+    // is chosen so that a segment covers about lodSegmentPixels pixels
+    bool lodEnabled = false;
+    float lodSegmentPixels = 4.f;
+
+    virtual ~Renderer();
+    virtual const char *name() const = 0;
+
+    // drawSphere() as a ray-cast impostor (4 vertices) instead of the
+    // tessellated mesh; returns false (mesh kept) if it is not available
+    bool enableSphereImpostor();
+
+    virtual void beginFrame() { stats.reset(); }
+    virtual void endFrame() { flush(); }
+    // Submit what has been buffered so far (before a framebuffer or GL state change)
+    virtual void flush() {}
+    // False when nothing reaches GL (no context needed)
+    virtual bool usesGL() const { return true; }
+
+    virtual void setViewport(int width, int height);
+    virtual void setProjection(const float mat[16]);
+    virtual void loadIdentity() { modelView.loadIdentity(); }
+    virtual void pushMatrix() { modelView.push(); }
+    virtual void popMatrix() { modelView.pop(); }
+    virtual void translate(float x, float y, float z) { modelView.translate(x, y, z); }
+    virtual void rotate(float angle, float x, float y, float z) { modelView.rotate(angle, x, y, z); }
+    virtual void scale(float x, float y, float z) { modelView.scale(x, y, z); }
+    // Multiply by a column-major matrix (a cached world matrix of a TransformTree)
+    virtual void multMatrix(const float mat[16]) { modelView.multiply(mat); }
+
+    virtual void setColor(float r, float g, float b, float a = 1.f) = 0;
+    virtual void setLineWidth(float width) = 0;
+
+    /* Cannonic objects, same geometry as in 3D_tools.
+       Round objects take an optional LodState (NULL: no hysteresis). */
+    virtual void drawSquare() = 0;
+    virtual void drawEmptySquare() = 0;
+    void drawCircle(LodState *lod = NULL) { drawCircleLevel(selectLod(lod)); }
+    void drawCone(LodState *lod = NULL) { drawConeLevel(selectLod(lod)); }
+    void drawSphere(LodState *lod = NULL);
+
+    // Level for the unit round object under the current model-view matrix
+    int selectLod(LodState *lod) const;
+
+protected:
+    MatrixStack modelView;
+    float projection[16];
+    int viewportWidth = 1;
+    int viewportHeight = 1;
+
+    bool sphereImpostor = false;
+    SphereImpostor *impostor = NULL; // GL resources of the impostor (GL backends only)
+
+    Renderer();
+    virtual void drawCircleLevel(int lod) = 0;
+    virtual void drawConeLevel(int lod) = 0;
+    virtual void drawSphereLevel(int lod) = 0;
+    virtual void drawSphereImpostor() = 0;
+};
+
+/* Original glBegin/glEnd path */
+class LegacyRenderer : public Renderer
+{
+public:
+    const char *name() const { return "legacy"; }
+
+    void setViewport(int width, int height);
+    void setProjection(const float mat[16]);
+    void loadIdentity();
+    void pushMatrix();
+    void popMatrix();
+    void translate(float x, float y, float z);
+    void rotate(float angle, float x, float y, float z);
+    void scale(float x, float y, float z);
+    void multMatrix(const float mat[16]);
+
+    void setColor(float r, float g, float b, float a = 1.f);
+    void setLineWidth(float width);
+
+    void drawSquare();
+    void drawEmptySquare();
+
+protected:
+    void drawCircleLevel(int lod);
+    void drawConeLevel(int lod);
+    void drawSphereLevel(int lod);
+    void drawSphereImpostor();
+
+private:
+    float color[4] = {1.f, 1.f, 1.f, 1.f}; // last setColor(), GL's initial current color before
+};
+
+/* Shader + VBO path: vertices are transformed on the CPU and accumulated
+   until the primitive type or the line width changes. The sphere is the
+   exception: an optimized indexed mesh kept in a static VBO/IBO per level,
+   transformed on the GPU. */
+class BatchedRenderer : public Renderer
+{
+public:
+    BatchedRenderer();
+    ~BatchedRenderer();
+    const char *name() const { return "batched"; }
+
+    void beginFrame();
+    void flush();
+
+    void setViewport(int width, int height);
+    void setProjection(const float mat[16]);
+
+    void setColor(float r, float g, float b, float a = 1.f);
+    void setLineWidth(float width);
+
+    void drawSquare();
+    void drawEmptySquare();
+
+protected:
+    void drawCircleLevel(int lod);
+    void drawConeLevel(int lod);
+    void drawSphereLevel(int lod);
+    void drawSphereImpostor();
+
+private:
+    struct Vertex
+    {
+        float x, y, z;
+        float r, g, b, a;
+    };
+
+    // GL buffers of a cached primitive mesh, built on first use
+    struct GpuMesh
+    {
+        unsigned int vao = 0;
+        unsigned int vbo = 0;
+        unsigned int ibo = 0;
+        int indexCount = 0;
+        int vertexCount = 0;
+        float scale = 1.f;
+    };
+
+    float color[4];
+    float lineWidth;
+
+    bool batchIsLines;
+    std::vector<Vertex> batch;
+
+    unsigned int program;
+    int projectionLocation;
+    unsigned int vao;
+    unsigned int vbo;
+
+    unsigned int meshProgram;
+    int meshProjectionLocation;
+    int meshModelViewLocation;
+    int meshColorLocation;
+    int meshScaleLocation;
+    std::vector<GpuMesh> sphereMeshes; // one per level of detail
+
+    void begin(bool lines);
+    void emit(float x, float y, float z);
+};
+
+/* Counts draws and vertices like the legacy path would submit them */
+class NullRenderer : public Renderer
+{
+public:
+    const char *name() const { return "null"; }
+    bool usesGL() const { return false; }
+
+    void setColor(float, float, float, float = 1.f) {}
+    void setLineWidth(float) {}
+
+    void drawSquare();
+    void drawEmptySquare();
+
+protected:
+    void drawCircleLevel(int lod);
+    void drawConeLevel(int lod);
+    void drawSphereLevel(int lod);
+    void drawSphereImpostor();
+};
+
+// Parse a --renderer value ("legacy", "batched" or "null")
+bool parseRendererBackend(const char *name, RENDERER_BACKENDS *backend);
+
+// Must be called once a GL context is current (except for RENDERER_NULL)
+Renderer *createRenderer(RENDERER_BACKENDS backend);
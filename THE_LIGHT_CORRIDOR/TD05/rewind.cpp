@@ -0,0 +1,109 @@
+#include "rewind.hpp"
+#include <algorithm>
+
+enum DELTA_FLAGS
+{
+    DELTA_BALL_THROWN = 1,
+    DELTA_BONUS_STICK = 2,
+    DELTA_BONUS_LIFE = 4
+};
+
+RewindBuffer::RewindBuffer(int capacityTicks)
+    : deltas(capacityTicks > 0 ? capacityTicks : 1), newest{-1}, count{0},
+      nextKeyframe{0}, currentKeyframe{0}, lastGeneration{-1}
+{
+}
+
+void RewindBuffer::record(const Game &game)
+{
+    // New level (or restored snapshot): new keyframe, ticks of the level it replaces are dropped
+    if (game.generation != lastGeneration || count == 0)
+    {
+        currentKeyframe = nextKeyframe++;
+        Keyframe &keyframe = keyframes[currentKeyframe % KEYFRAMES];
+        keyframe.snapshot = game.snapshot();
+        keyframe.generation = game.generation;
+        lastGeneration = game.generation;
+        while (count > 0 && currentKeyframe - delta(count - 1).keyframe >= (unsigned int)KEYFRAMES)
+        {
+            count--;
+        }
+    }
+
+    newest = (newest + 1) % deltas.size();
+    count = std::min<int>(count + 1, deltas.size());
+    TickDelta &tick = deltas[newest];
+    tick.ballPos = game.ball.pos;
+    tick.ballSpeed = game.ball.speed;
+    tick.racketX = game.player.pos.x;
+    tick.racketZ = game.player.pos.z;
+    tick.currentPos = game.currentPos;
+    tick.score = game.score;
+    tick.keyframe = currentKeyframe;
+    tick.life = game.life;
+    tick.gameState = game.gameState;
+    tick.flags = (game.ball.isThrown ? DELTA_BALL_THROWN : 0) |
+                 (game.player.bonusStick ? DELTA_BONUS_STICK : 0) |
+                 (game.player.bonusLife ? DELTA_BONUS_LIFE : 0);
+}
+
+bool RewindBuffer::stepBack(Game *game)
+{
+    if (count < 2)
+    {
+        return false;
+    }
+    newest = (newest + deltas.size() - 1) % deltas.size();
+    count--;
+    // Keyframes of the dropped future are given back
+    nextKeyframe = deltas[newest].keyframe + 1;
+    return restore(0, game);
+}
+
+bool RewindBuffer::restore(int ticksAgo, Game *game)
+{
+    if (ticksAgo < 0 || ticksAgo >= count)
+    {
+        return false;
+    }
+    const TickDelta &tick = delta(ticksAgo);
+    apply(tick, game);
+    if (ticksAgo == 0)
+    {
+        currentKeyframe = tick.keyframe;
+        lastGeneration = game->generation;
+    }
+    return true;
+}
+
+std::size_t RewindBuffer::memoryBytes() const
+{
+    return deltas.size() * sizeof(TickDelta) + sizeof(keyframes);
+}
+
+const TickDelta &RewindBuffer::delta(int ticksAgo) const
+{
+    return deltas[(newest + deltas.size() - ticksAgo) % deltas.size()];
+}
+
+void RewindBuffer::apply(const TickDelta &tick, Game *game)
+{
+    // The whole level only when the game holds another one
+    Keyframe &keyframe = keyframes[tick.keyframe % KEYFRAMES];
+    if (game->generation != keyframe.generation)
+    {
+        game->restore(keyframe.snapshot);
+        keyframe.generation = game->generation;
+    }
+    game->ball.pos = tick.ballPos;
+    game->ball.speed = tick.ballSpeed;
+    game->ball.isThrown = tick.flags & DELTA_BALL_THROWN;
+    game->player.pos.x = tick.racketX;
+    game->player.pos.z = tick.racketZ;
+    game->player.bonusStick = tick.flags & DELTA_BONUS_STICK;
+    game->player.bonusLife = tick.flags & DELTA_BONUS_LIFE;
+    game->currentPos = tick.currentPos;
+    game->score = tick.score;
+    game->life = tick.life;
+    game->gameState = (GAME_STATES)tick.gameState;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "elements.hpp"
+#include <cstddef>
+#include <vector>
+
+/* Rewind history of the last ticks, allocated once.
+   A tick only changes the ball, the racket position, the progress in the
+   corridor, score, life and state: that is all a TickDelta holds. The
+   rest (corridor, obstacles, sizes) only changes when a level is loaded or
+   restored, and is kept as a keyframe snapshot per level. Any held tick is
+   rebuilt from its keyframe and its own delta, without replaying the ticks
+   between them. Ticks whose keyframe was overwritten (more than
+   KEYFRAMES levels loaded in the window) are dropped. */
+class TickDelta
+{
+public:
+    Vec3s ballPos;
+    Vec3s ballSpeed;
+    Scalar racketX, racketZ;
+    Scalar currentPos;
+    int score;
+    unsigned int keyframe; // serial number of the keyframe of the level
+    signed char life;
+    unsigned char gameState;
+    unsigned char flags; // DELTA_* bits
+};
+
+class RewindBuffer
+{
+public:
+    static const int KEYFRAMES = 16;
+
+    explicit RewindBuffer(int capacityTicks);
+
+    // Append the state reached by a tick, the oldest tick is dropped when full
+    void record(const Game &game);
+
+    // Drop the newest tick and put game back to the one before it.
+    // Returns false (game unchanged) when no older tick is held.
+    bool stepBack(Game *game);
+
+    // Rebuild the tick ticksAgo ticks before the newest one (0 = newest)
+    bool restore(int ticksAgo, Game *game);
+
+    int size() const { return count; }
+    int capacity() const { return deltas.size(); }
+    std::size_t memoryBytes() const;
+
+private:
+    class Keyframe
+    {
+    public:
+        GameSnapshot snapshot;
+        int generation; // of the Game when the level was last applied to it
+    };
+
+    std::vector<TickDelta> deltas;
+    int newest; // index of the newest delta
+    int count;
+    Keyframe keyframes[KEYFRAMES];
+    unsigned int nextKeyframe;    // serial of the next keyframe
+    unsigned int currentKeyframe; // serial of the keyframe recorded ticks refer to
+    int lastGeneration;           // Game::generation seen by the last record()
+
+    const TickDelta &delta(int ticksAgo) const;
+    void apply(const TickDelta &tick, Game *game);
+};
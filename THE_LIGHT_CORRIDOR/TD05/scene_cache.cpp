@@ -0,0 +1,152 @@
+#include "glad/glad.h"
+#include "scene_cache.hpp"
+#include "draw_scene.hpp"
+#include "shader.hpp"
+
+static const char *COMPOSITE_VERTEX_SHADER =
+    "#version 120\n"
+    "attribute vec2 aPosition;\n"
+    "varying vec2 vUv;\n"
+    "void main()\n"
+    "{\n"
+    "    vUv = aPosition * 0.5 + 0.5;\n"
+    "    gl_Position = vec4(aPosition, 0.0, 1.0);\n"
+    "}\n";
+
+static const char *COMPOSITE_FRAGMENT_SHADER =
+    "#version 120\n"
+    "uniform sampler2D uColor;\n"
+    "uniform sampler2D uDepth;\n"
+    "varying vec2 vUv;\n"
+    "void main()\n"
+    "{\n"
+    "    gl_FragColor = texture2D(uColor, vUv);\n"
+    "    gl_FragDepth = texture2D(uDepth, vUv).r;\n"
+    "}\n";
+
+SceneCache::SceneCache()
+    : program{0}, vao{0}, vbo{0}, valid{false}, cachedPos{0.}, cachedGeneration{-1},
+      cachedDrawSections{0}, cachedLodEnabled{false}, cachedLodPixels{0.f}
+{
+    const char *attribs[] = {"aPosition", NULL};
+    program = createProgram(COMPOSITE_VERTEX_SHADER, COMPOSITE_FRAGMENT_SHADER, attribs);
+    glUseProgram(program);
+    glUniform1i(glGetUniformLocation(program, "uColor"), 0);
+    glUniform1i(glGetUniformLocation(program, "uDepth"), 1);
+    glUseProgram(0);
+
+    // Full screen triangle strip
+    const float quad[] = {-1.f, -1.f, 1.f, -1.f, -1.f, 1.f, 1.f, 1.f};
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &vbo);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, (void *)0);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+SceneCache::~SceneCache()
+{
+    glDeleteBuffers(1, &vbo);
+    glDeleteVertexArrays(1, &vao);
+    glDeleteProgram(program);
+}
+
+void SceneCache::draw(Renderer &renderer, const Game &game)
+{
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+
+    if (!valid || cachedPos != toDouble(game.currentPos) || cachedGeneration != game.generation ||
+        framebuffer.width != viewport[2] || framebuffer.height != viewport[3] ||
+        cachedDrawSections != drawDistance() || cachedLodEnabled != renderer.lodEnabled ||
+        cachedLodPixels != renderer.lodSegmentPixels)
+    {
+        rebuild(renderer, game, viewport[2], viewport[3]);
+    }
+
+    if (valid)
+    {
+        composite();
+        renderer.stats.drawCalls++;
+        renderer.stats.vertices += 4;
+    }
+
+    // Same order as drawGame(): the ball, then the translucent obstacles
+    // over it, then the walls when there is no usable cache
+    Vec3s ball, racket;
+    latchPositions(game, &ball, &racket);
+    renderer.pushMatrix();
+    renderer.translate(0, -toDouble(game.currentPos), 0);
+    drawBall(renderer, game.ball, ball);
+    drawCorridor(renderer, game, valid ? CORRIDOR_OBSTACLES : CORRIDOR_ALL);
+    renderer.popMatrix();
+    drawPlayer(renderer, game.player, racket);
+}
+
+void SceneCache::rebuild(Renderer &renderer, const Game &game, int width, int height)
+{
+    GLint target = 0;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &target);
+
+    if (framebuffer.width != width || framebuffer.height != height || !framebuffer.isValid())
+    {
+        valid = framebuffer.create(width, height);
+        if (!valid)
+        {
+            return;
+        }
+    }
+
+    renderer.flush();
+    framebuffer.bind();
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    renderer.pushMatrix();
+    renderer.translate(0, -toDouble(game.currentPos), 0);
+    drawCorridor(renderer, game, CORRIDOR_WALLS);
+    renderer.popMatrix();
+    renderer.flush();
+
+    glBindFramebuffer(GL_FRAMEBUFFER, target);
+    glViewport(0, 0, width, height);
+
+    valid = true;
+    cachedPos = toDouble(game.currentPos);
+    cachedGeneration = game.generation;
+    cachedDrawSections = drawDistance();
+    cachedLodEnabled = renderer.lodEnabled;
+    cachedLodPixels = renderer.lodSegmentPixels;
+    rebuilds++;
+}
+
+// Copy color and depth of the cache into the current framebuffer
+void SceneCache::composite()
+{
+    GLboolean blend = glIsEnabled(GL_BLEND);
+    GLint depthFunc;
+    glGetIntegerv(GL_DEPTH_FUNC, &depthFunc);
+    glDisable(GL_BLEND);
+    glDepthFunc(GL_ALWAYS);
+
+    glUseProgram(program);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, framebuffer.colorTexture);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, framebuffer.depthTexture);
+    glBindVertexArray(vao);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glUseProgram(0);
+
+    glDepthFunc(depthFunc);
+    if (blend)
+    {
+        glEnable(GL_BLEND);
+    }
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "elements.hpp"
+#include "framebuffer.hpp"
+#include "renderer.hpp"
+
+/* The opaque corridor (walls, section frames) only moves when the player
+   moves forward, so it is rendered once into a color + depth texture and
+   then composited every frame; the ball, the few translucent obstacles and
+   the racket are drawn on top, depth tested against the cached depth, so a
+   ball behind an obstacle is still seen through it.
+   The cache is rebuilt when the player moves, a level is loaded, or the
+   viewport size, draw distance or level of detail settings change. */
+class SceneCache
+{
+public:
+    SceneCache();
+    ~SceneCache();
+
+    // Draw an ongoing game into the current framebuffer / viewport
+    void draw(Renderer &renderer, const Game &game);
+    void invalidate() { valid = false; }
+
+    long rebuilds = 0; // number of times the corridor has been rendered
+
+private:
+    Framebuffer framebuffer;
+    unsigned int program;
+    unsigned int vao;
+    unsigned int vbo;
+
+    bool valid;
+    double cachedPos;
+    int cachedGeneration;
+    int cachedDrawSections;
+    bool cachedLodEnabled;
+    float cachedLodPixels;
+
+    void rebuild(Renderer &renderer, const Game &game, int width, int height);
+    void composite();
+};
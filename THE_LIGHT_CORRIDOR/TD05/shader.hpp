@@ -0,0 +1,10 @@
+#pragma once
+
+/* Small GLSL helpers shared by the modern GL code paths.
+   GL handles are exposed as unsigned int so this header can be included
+   next to <GL/gl.h> as well as next to glad. */
+
+// Compile and link a program from vertex + fragment sources.
+// attribNames (NULL terminated, may be NULL) are bound to locations 0, 1, 2...
+// Returns 0 (and prints the info log) on failure.
+unsigned int createProgram(const char *vertexSource, const char *fragmentSource, const char *const *attribNames);
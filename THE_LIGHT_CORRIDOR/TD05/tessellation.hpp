@@ -0,0 +1,130 @@
+#pragma once
+
+/* Unit circle and unit sphere vertices generated at compile time.
+   Tables are template parameterized on the number of segments and emitted as
+   static read-only arrays: no trigonometry at startup nor when drawing.
+   Layouts are the ones drawn by 3D_tools:
+   - CircleTable<N>::vertices: N + 1 (x, y) points, the first one repeated at the end
+   - SphereTable<N>::vertices: N bands, each a triangle strip of 2 * (N + 1) (x, y, z) points */
+
+namespace tessellation
+{
+    constexpr double PI = 3.14159265358979323846;
+
+    /* constexpr sine / cosine (C++11: one return statement per function) */
+
+    // Taylor series of sin around 0, good to double precision on [-pi/2, pi/2]
+    constexpr double sinSeries(double x, double term, int n)
+    {
+        return (term < 1e-17 && term > -1e-17) ? 0. : term + sinSeries(x, -term * x * x / ((2 * n + 2) * (2 * n + 3)), n + 1);
+    }
+
+    // Bring x in [-pi, pi]
+    constexpr double wrap(double x)
+    {
+        return x > PI ? wrap(x - 2 * PI) : (x < -PI ? wrap(x + 2 * PI) : x);
+    }
+
+    // sin on [-pi, pi] using sin(x) = sin(pi - x) to stay in the series range
+    constexpr double sinWrapped(double x)
+    {
+        return x > PI / 2 ? sinSeries(PI - x, PI - x, 0) : (x < -PI / 2 ? sinSeries(-PI - x, -PI - x, 0) : sinSeries(x, x, 0));
+    }
+
+    constexpr double sine(double x)
+    {
+        return sinWrapped(wrap(x));
+    }
+
+    constexpr double cosine(double x)
+    {
+        return sine(x + PI / 2);
+    }
+
+    /* Compile-time index lists, built in logarithmic template depth so that
+       large tables (24960 floats for a 64 segments sphere) stay instantiable */
+
+    template <int... I>
+    struct IndexList
+    {
+    };
+
+    template <class A, class B>
+    struct ConcatIndexList;
+
+    template <int... A, int... B>
+    struct ConcatIndexList<IndexList<A...>, IndexList<B...>>
+    {
+        typedef IndexList<A..., (int)sizeof...(A) + B...> type;
+    };
+
+    template <int N>
+    struct MakeIndexList
+    {
+        typedef typename ConcatIndexList<typename MakeIndexList<N / 2>::type, typename MakeIndexList<N - N / 2>::type>::type type;
+    };
+
+    template <>
+    struct MakeIndexList<0>
+    {
+        typedef IndexList<> type;
+    };
+
+    template <>
+    struct MakeIndexList<1>
+    {
+        typedef IndexList<0> type;
+    };
+
+    /* Value of the i-th float of each table */
+
+    constexpr float circleCoordinate(int segments, int i)
+    {
+        return (float)(i % 2 == 0 ? cosine(2 * PI * (i / 2) / segments) : sine(2 * PI * (i / 2) / segments));
+    }
+
+    // Point of a band strip: even points on the band top circle (theta), odd on the bottom one (theta + step)
+    constexpr float spherePointCoordinate(int segments, int band, int count, int bottom, int component)
+    {
+        return (float)(component == 0   ? cosine(2 * PI * count / segments) * sine(PI * (band + bottom) / segments)
+                       : component == 1 ? sine(2 * PI * count / segments) * sine(PI * (band + bottom) / segments)
+                                        : cosine(PI * (band + bottom) / segments));
+    }
+
+    constexpr float sphereCoordinate(int segments, int i)
+    {
+        return spherePointCoordinate(segments,
+                                     i / (6 * (segments + 1)),       // band
+                                     (i % (6 * (segments + 1))) / 6, // position along the band
+                                     (i % 6) / 3,                    // top or bottom circle
+                                     i % 3);                         // x, y or z
+    }
+
+    /* Tables */
+
+    template <int SEGMENTS, class Indices = typename MakeIndexList<2 * (SEGMENTS + 1)>::type>
+    struct CircleTable;
+
+    template <int SEGMENTS, int... I>
+    struct CircleTable<SEGMENTS, IndexList<I...>>
+    {
+        static constexpr int FLOATS = sizeof...(I);
+        static constexpr float vertices[sizeof...(I)] = {circleCoordinate(SEGMENTS, I)...};
+    };
+
+    template <int SEGMENTS, int... I>
+    constexpr float CircleTable<SEGMENTS, IndexList<I...>>::vertices[sizeof...(I)];
+
+    template <int SEGMENTS, class Indices = typename MakeIndexList<3 * 2 * (SEGMENTS + 1) * SEGMENTS>::type>
+    struct SphereTable;
+
+    template <int SEGMENTS, int... I>
+    struct SphereTable<SEGMENTS, IndexList<I...>>
+    {
+        static constexpr int FLOATS = sizeof...(I);
+        static constexpr float vertices[sizeof...(I)] = {sphereCoordinate(SEGMENTS, I)...};
+    };
+
+    template <int SEGMENTS, int... I>
+    constexpr float SphereTable<SEGMENTS, IndexList<I...>>::vertices[sizeof...(I)];
+}
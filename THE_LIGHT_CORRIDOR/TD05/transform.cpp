@@ -0,0 +1,59 @@
+#include "transform.hpp"
+
+int TransformTree::addNode(int parent, const Mat4 &local)
+{
+    Node node;
+    node.parent = parent;
+    node.local = local;
+    node.world = local;
+    node.dirty = true;
+    node.changed = false;
+    nodes.push_back(node);
+    anyDirty = true;
+    return nodes.size() - 1;
+}
+
+void TransformTree::setLocal(int node, const Mat4 &local)
+{
+    if (nodes[node].local != local)
+    {
+        nodes[node].local = local;
+        nodes[node].dirty = true;
+        anyDirty = true;
+    }
+}
+
+void TransformTree::update()
+{
+    if (!anyDirty)
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < nodes.size(); i++)
+    {
+        Node &node = nodes[i];
+        bool parentChanged = node.parent != NO_PARENT && nodes[node.parent].changed;
+        node.changed = node.dirty || parentChanged;
+        if (node.changed)
+        {
+            if (node.parent == NO_PARENT)
+            {
+                node.world = node.local;
+            }
+            else
+            {
+                node.world = nodes[node.parent].world * node.local;
+            }
+            node.dirty = false;
+            recomputed++;
+        }
+    }
+    anyDirty = false;
+}
+
+void TransformTree::clear()
+{
+    nodes.clear();
+    anyDirty = false;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "math3d.hpp"
+#include <vector>
+
+/* Transform hierarchy with cached world matrices.
+   Nodes are referenced by index and a parent is always added before its
+   children, so one pass in index order updates the whole tree. A world
+   matrix is only recomputed when the node local transform or one of its
+   ancestors changed: static nodes cost nothing after they are built. */
+class TransformTree
+{
+public:
+    static const int NO_PARENT = -1;
+
+    long recomputed = 0; // world matrices computed since creation
+
+    // Returns the index of the new node
+    int addNode(int parent, const Mat4 &local);
+    // Marks the node dirty only if the matrix actually changed
+    void setLocal(int node, const Mat4 &local);
+    const Mat4 &local(int node) const { return nodes[node].local; }
+
+    // Recompute the dirty world matrices, nothing to do if none changed
+    void update();
+    // Valid after update()
+    const Mat4 &world(int node) const { return nodes[node].world; }
+
+    void clear();
+    int size() const { return nodes.size(); }
+
+private:
+    struct Node
+    {
+        int parent;
+        Mat4 local;
+        Mat4 world;
+        bool dirty;
+        bool changed; // world recomputed by the current update()
+    };
+
+    std::vector<Node> nodes;
+    bool anyDirty = false;
+};
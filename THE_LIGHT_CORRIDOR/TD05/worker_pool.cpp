@@ -0,0 +1,80 @@
+#include "worker_pool.hpp"
+#include "profiler.hpp"
+
+WorkerPool::WorkerPool(int threads)
+    : job{NULL}, count{0}, next{0}, busy{0}, batch{0}, stopping{false}
+{
+    for (int i = 0; i < threads; i++)
+    {
+        workers.push_back(std::thread(&WorkerPool::workerLoop, this));
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (size_t i = 0; i < workers.size(); i++)
+    {
+        workers[i].join();
+    }
+}
+
+void WorkerPool::run(int jobCount, const std::function<void(int)> &jobFunction)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = &jobFunction;
+        count = jobCount;
+        next = 0;
+        busy = workers.size();
+        batch++;
+    }
+    wake.notify_all();
+
+    work();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this]
+              { return busy == 0; });
+    job = NULL;
+}
+
+// Take jobs until there is none left
+void WorkerPool::work()
+{
+    for (int i = next++; i < count; i = next++)
+    {
+        (*job)(i);
+    }
+}
+
+void WorkerPool::workerLoop()
+{
+    PROFILE_THREAD("worker");
+    long seen = 0;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this, seen]
+                      { return stopping || batch != seen; });
+            if (stopping)
+            {
+                return;
+            }
+            seen = batch;
+        }
+
+        work();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--busy == 0)
+        {
+            done.notify_one();
+        }
+    }
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* Fixed set of worker threads running parallel-for jobs.
+   The calling thread takes part in the work, so a pool of 0 threads runs
+   everything inline. */
+class WorkerPool
+{
+public:
+    explicit WorkerPool(int threads);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool &) = delete;
+    WorkerPool &operator=(const WorkerPool &) = delete;
+
+    int size() const { return workers.size(); }
+
+    // Call job(i) for every i in [0, count), returns once all calls are done
+    void run(int count, const std::function<void(int)> &job);
+
+private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+
+    const std::function<void(int)> *job;
+    int count;
+    std::atomic<int> next;
+    int busy;        // workers still inside the current batch
+    long batch;      // incremented by each run()
+    bool stopping;
+
+    void workerLoop();
+    void work();
+};